@@ -13,23 +13,48 @@ DEFINES += APP_VERSION=\\\"$$VERSION\\\"
 
 QMAKE_CXXFLAGS += -O2
 
+# Vectorized calculation kernels must match the scalar kernel exactly, and
+# double-double arithmetic relies on exact rounding of each operation, thus
+# floating point contraction (fused multiply-add) must be disabled
+contains(QMAKE_COMPILER, gcc): QMAKE_CXXFLAGS += -ffp-contract=off
+
 SOURCES += \
     calcstatusdialog.cpp \
+    cpufeatures.cpp \
+    hpreal.cpp \
+    imagerenderer.cpp \
+    itercodec.cpp \
+    iterfile.cpp \
     main.cpp \
     mainwindow.cpp \
     mandelbrotcalc.cpp \
+    mandelbrotkernels.cpp \
+    mandelbrotperturb.cpp \
     mandelbrotviewer.cpp \
     paletteeditdialog.cpp \
-    palettegenerator.cpp
+    palettegenerator.cpp \
+    threadpool.cpp \
+    tilecache.cpp \
+    tilestore.cpp
 
 HEADERS += \
     calcstatusdialog.h \
+    cpufeatures.h \
+    doubledouble.h \
+    iterbuffer.h \
+    itercodec.h \
+    iterfile.h \
+    hpreal.h \
+    imagerenderer.h \
     mainwindow.h \
     mandelbrotcalc.h \
     mandelbrotviewer.h \
     paletteeditdialog.h \
     palettegenerator.h \
-    paletteinfo.h
+    paletteinfo.h \
+    threadpool.h \
+    tilecache.h \
+    tilestore.h
 
 FORMS += \
     calcstatusdialog.ui \
@@ -0,0 +1,84 @@
+#include "cpufeatures.h"
+
+#if defined(_MSC_VER) && ( defined(_M_X64) || defined(_M_IX86) )
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief Returns the highest SIMD level supported by both CPU and OS
+ * @return Supported SIMD level
+ */
+CpuFeatures::SimdLevel
+CpuFeatures::simdLevel()
+{
+    // Thread-safe one-time initialization
+    static const SimdLevel level = detect();
+
+    return level;
+}
+
+/**
+ * @brief Returns a display name for a SIMD level
+ * @param a_level - SIMD level
+ * @return Level name
+ */
+const char *
+CpuFeatures::simdLevelName( SimdLevel a_level )
+{
+    switch ( a_level )
+    {
+    case SIMD_AVX2:     return "AVX2";
+    case SIMD_AVX512:   return "AVX-512";
+    default:            return "scalar";
+    }
+}
+
+/**
+ * @brief Performs CPUID-based feature detection
+ * @return Highest supported SIMD level
+ */
+CpuFeatures::SimdLevel
+CpuFeatures::detect()
+{
+#if ( defined(__GNUC__) || defined(__clang__) ) && ( defined(__x86_64__) || defined(__i386__) )
+
+    // The GCC/Clang builtins also verify OS support of extended register state (XGETBV)
+    __builtin_cpu_init();
+
+    if ( __builtin_cpu_supports( "avx512f" ))
+        return SIMD_AVX512;
+
+    if ( __builtin_cpu_supports( "avx2" ))
+        return SIMD_AVX2;
+
+#elif defined(_MSC_VER) && ( defined(_M_X64) || defined(_M_IX86) )
+
+    int regs[4];
+
+    __cpuid( regs, 0 );
+    if ( regs[0] < 7 )
+        return SIMD_NONE;
+
+    // Check OSXSAVE and AVX bits, then OS support of YMM state
+    __cpuid( regs, 1 );
+    if (( regs[2] & ( 1 << 27 )) == 0 || ( regs[2] & ( 1 << 28 )) == 0 )
+        return SIMD_NONE;
+
+    unsigned long long xcr0 = _xgetbv( 0 );
+    if (( xcr0 & 0x6 ) != 0x6 )
+        return SIMD_NONE;
+
+    __cpuidex( regs, 7, 0 );
+
+    // AVX-512F requires OS support of opmask and ZMM state
+    if (( regs[1] & ( 1 << 16 )) && ( xcr0 & 0xE6 ) == 0xE6 )
+        return SIMD_AVX512;
+
+    if ( regs[1] & ( 1 << 5 ))
+        return SIMD_AVX2;
+
+#endif
+
+    return SIMD_NONE;
+}
@@ -0,0 +1,49 @@
+#ifndef CPUFEATURES_H
+#define CPUFEATURES_H
+
+#include <cstdint>
+
+// Defined when compiling for x86/x86-64 (SIMD kernels are only available on these targets)
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CPU_X86
+#endif
+
+// Function attributes used to compile individual functions for a given instruction set.
+// MSVC does not require (or support) these, intrinsics may be used in any function.
+#if defined(CPU_X86) && ( defined(__GNUC__) || defined(__clang__) )
+#define CPU_TARGET_AVX2     __attribute__((target("avx2")))
+#define CPU_TARGET_AVX512   __attribute__((target("avx512f")))
+#else
+#define CPU_TARGET_AVX2
+#define CPU_TARGET_AVX512
+#endif
+
+/**
+ * @brief The CpuFeatures class detects SIMD instruction set support at runtime
+ *
+ * Detection is performed once (on first use) using CPUID, including a check
+ * that the operating system saves the extended register state. Code that
+ * provides vectorized paths should query simdLevel() and fall back to a
+ * scalar implementation when the required level is not available.
+ */
+class CpuFeatures
+{
+public:
+    /**
+     * @brief The SimdLevel enum lists supported vector instruction set levels (ascending)
+     */
+    enum SimdLevel : uint8_t
+    {
+        SIMD_NONE = 0,  // Scalar code only
+        SIMD_AVX2,      // AVX2 (256-bit vectors)
+        SIMD_AVX512     // AVX-512F (512-bit vectors)
+    };
+
+    static SimdLevel    simdLevel();
+    static const char * simdLevelName( SimdLevel a_level );
+
+private:
+    static SimdLevel    detect();
+};
+
+#endif // CPUFEATURES_H
@@ -0,0 +1,138 @@
+#ifndef DOUBLEDOUBLE_H
+#define DOUBLEDOUBLE_H
+
+#include <cmath>
+
+/**
+ * @brief The DoubleDouble class implements ~106-bit floating point arithmetic using two doubles
+ *
+ * A value is represented as the unevaluated sum of a high and low double, where
+ * |lo| <= ulp(hi)/2. Error-free transformations (Knuth two-sum, Dekker split and
+ * two-product) are used rather than fused multiply-add so that results are the same
+ * on all targets. These transformations require strict IEEE double arithmetic, thus
+ * floating point contraction must be disabled (see project file).
+ *
+ * Addition uses the fast ("sloppy") algorithm, whose error is relative to the
+ * magnitude of the operands rather than the result. This is sufficient for the
+ * Mandelbrot iteration, where all values are of similar (small) magnitude.
+ */
+class DoubleDouble
+{
+public:
+    double      hi;     // High part (nearest double to value)
+    double      lo;     // Low part (remainder)
+
+    DoubleDouble( double a_value = 0 ):
+        hi( a_value ), lo( 0 )
+    {}
+
+    DoubleDouble( double a_hi, double a_lo ):
+        hi( a_hi ), lo( a_lo )
+    {}
+
+    DoubleDouble
+    operator+( const DoubleDouble & a_other ) const
+    {
+        double s, e;
+        twoSum( hi, a_other.hi, s, e );
+        e += lo + a_other.lo;
+        return quickTwoSum( s, e );
+    }
+
+    DoubleDouble
+    operator-( const DoubleDouble & a_other ) const
+    {
+        return *this + -a_other;
+    }
+
+    DoubleDouble
+    operator-() const
+    {
+        return DoubleDouble( -hi, -lo );
+    }
+
+    DoubleDouble
+    operator*( const DoubleDouble & a_other ) const
+    {
+        double p, e;
+        twoProd( hi, a_other.hi, p, e );
+        e += hi*a_other.lo + lo*a_other.hi;
+        return quickTwoSum( p, e );
+    }
+
+    DoubleDouble
+    operator*( double a_other ) const
+    {
+        double p, e;
+        twoProd( hi, a_other, p, e );
+        e += lo*a_other;
+        return quickTwoSum( p, e );
+    }
+
+    DoubleDouble &
+    operator*=( const DoubleDouble & a_other )
+    {
+        return *this = *this * a_other;
+    }
+
+    bool
+    operator<( const DoubleDouble & a_other ) const
+    {
+        return hi < a_other.hi || ( hi == a_other.hi && lo < a_other.lo );
+    }
+
+private:
+    /**
+     * @brief Error-free sum: a + b = s + e
+     */
+    static inline void
+    twoSum( double a, double b, double & s, double & e )
+    {
+        s = a + b;
+        double bb = s - a;
+        e = ( a - ( s - bb )) + ( b - bb );
+    }
+
+    /**
+     * @brief Normalizes a sum where |a| >= |b|
+     */
+    static inline DoubleDouble
+    quickTwoSum( double a, double b )
+    {
+        double s = a + b;
+        return DoubleDouble( s, b - ( s - a ));
+    }
+
+    /**
+     * @brief Error-free product: a * b = p + e (Dekker)
+     */
+    static inline void
+    twoProd( double a, double b, double & p, double & e )
+    {
+        const double split = 134217729.0;   // 2^27 + 1
+        double t, ah, al, bh, bl;
+
+        p = a*b;
+        t = split*a;
+        ah = t - ( t - a );
+        al = a - ah;
+        t = split*b;
+        bh = t - ( t - b );
+        bl = b - bh;
+        e = (( ah*bh - p ) + ah*bl + al*bh ) + al*bl;
+    }
+};
+
+inline DoubleDouble
+operator*( double a_lhs, const DoubleDouble & a_rhs )
+{
+    return a_rhs*a_lhs;
+}
+
+inline DoubleDouble
+fabs( const DoubleDouble & a_value )
+{
+    return a_value.hi < 0 ? -a_value : a_value;
+}
+
+#endif // DOUBLEDOUBLE_H
@@ -0,0 +1,396 @@
+#include <stdexcept>
+#include <cmath>
+#include <cctype>
+#include <cstdio>
+#include "hpreal.h"
+
+using namespace std;
+
+/**
+ * @brief HPReal constructor - creates a zero value
+ * @param a_frac_limbs - Number of 32-bit fraction limbs (precision)
+ */
+HPReal::HPReal( uint16_t a_frac_limbs ):
+    m_limbs( a_frac_limbs + 1, 0 ),
+    m_frac( a_frac_limbs )
+{}
+
+/**
+ * @brief HPReal constructor - converts a double (exactly, if precision allows)
+ * @param a_value - Value to convert
+ * @param a_frac_limbs - Number of 32-bit fraction limbs (precision)
+ */
+HPReal::HPReal( double a_value, uint16_t a_frac_limbs ):
+    m_limbs( a_frac_limbs + 1, 0 ),
+    m_frac( a_frac_limbs )
+{
+    if ( a_value == 0 || !isfinite( a_value ))
+        return;
+
+    // Split value into 53-bit integer mantissa and binary exponent
+    int         exp;
+    double      mant = frexp( fabs( a_value ), &exp );
+    uint64_t    m = (uint64_t)ldexp( mant, 53 );
+    int64_t     pos = (int64_t)exp - 53 + 32*(int64_t)m_frac;   // Bit position of mantissa LSB
+
+    if ( pos < 0 )
+    {
+        if ( pos <= -64 )
+            return;
+
+        m >>= -pos;
+        pos = 0;
+    }
+
+    // Place mantissa bits (up to three limbs)
+    for ( int b = 0; b < 64 && m; b += 32, m >>= 32 )
+    {
+        size_t  limb = ( pos + b ) / 32;
+        int     shift = ( pos + b ) % 32;
+        uint64_t part = ( m & 0xFFFFFFFF ) << shift;
+
+        if ( limb < m_limbs.size() )
+            m_limbs[limb] |= (uint32_t)part;
+        if ( limb + 1 < m_limbs.size() )
+            m_limbs[limb + 1] |= (uint32_t)( part >> 32 );
+    }
+
+    if ( a_value < 0 )
+        negate();
+}
+
+/**
+ * @brief HPReal constructor - parses a decimal string
+ * @param a_value - Decimal value (i.e. "-1.25", "3.1e-20")
+ * @param a_frac_limbs - Number of 32-bit fraction limbs (precision)
+ *
+ * Throws invalid_argument if the string is not a valid decimal number.
+ */
+HPReal::HPReal( const string & a_value, uint16_t a_frac_limbs ):
+    m_limbs( a_frac_limbs + 1, 0 ),
+    m_frac( a_frac_limbs )
+{
+    vector<uint32_t>    mag( 1, 0 );    // Magnitude of all digits as integer
+    string::const_iterator c = a_value.begin();
+    bool                neg = false, dot = false, digits = false;
+    int64_t             exp = 0;
+    uint64_t            t;
+
+    if ( c != a_value.end() && ( *c == '-' || *c == '+' ))
+    {
+        neg = *c++ == '-';
+    }
+
+    for ( ; c != a_value.end(); c++ )
+    {
+        if ( isdigit( *c ))
+        {
+            // mag = mag*10 + digit
+            t = *c - '0';
+            for ( size_t i = 0; i < mag.size(); i++ )
+            {
+                t += (uint64_t)mag[i]*10;
+                mag[i] = (uint32_t)t;
+                t >>= 32;
+            }
+            if ( t )
+                mag.push_back( (uint32_t)t );
+
+            if ( dot )
+                exp--;
+
+            digits = true;
+        }
+        else if ( *c == '.' && !dot )
+        {
+            dot = true;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    if ( c != a_value.end() && ( *c == 'e' || *c == 'E' ))
+    {
+        size_t  len;
+        try
+        {
+            exp += stol( string( c + 1, a_value.end() ), &len );
+        }
+        catch ( ... )
+        {
+            throw invalid_argument( "Invalid number: " + a_value );
+        }
+
+        c += len + 1;
+    }
+
+    if ( !digits || c != a_value.end() )
+    {
+        throw invalid_argument( "Invalid number: " + a_value );
+    }
+
+    // Scale magnitude to fixed-point (shift left by fraction limbs)
+    mag.insert( mag.begin(), m_frac, 0 );
+
+    // Apply decimal exponent in chunks of up to 10^9
+    while ( exp > 0 )
+    {
+        uint32_t p = 1;
+        for ( ; exp > 0 && p < 1000000000; exp-- )
+            p *= 10;
+
+        t = 0;
+        for ( size_t i = 0; i < mag.size(); i++ )
+        {
+            t += (uint64_t)mag[i]*p;
+            mag[i] = (uint32_t)t;
+            t >>= 32;
+        }
+        if ( t )
+            mag.push_back( (uint32_t)t );
+    }
+
+    while ( exp < 0 )
+    {
+        uint32_t p = 1;
+        for ( ; exp < 0 && p < 1000000000; exp++ )
+            p *= 10;
+
+        t = 0;
+        for ( size_t i = mag.size(); i-- > 0; )
+        {
+            t = ( t << 32 ) | mag[i];
+            mag[i] = (uint32_t)( t / p );
+            t %= p;
+        }
+    }
+
+    for ( size_t i = 0; i < m_limbs.size() && i < mag.size(); i++ )
+        m_limbs[i] = mag[i];
+
+    if ( neg )
+        negate();
+}
+
+/**
+ * @brief Computes number of fraction limbs needed for a given number of fraction bits
+ * @param a_bits - Required fraction bits
+ * @return Fraction limb count (at least 2)
+ */
+uint16_t
+HPReal::limbsForBits( int32_t a_bits )
+{
+    return a_bits <= 64 ? 2 : (uint16_t)(( a_bits + 31 ) / 32 );
+}
+
+/**
+ * @brief Addition operator
+ * @param a_other - Value to add
+ * @return Sum (at highest precision of operands)
+ */
+HPReal
+HPReal::operator+( const HPReal & a_other ) const
+{
+    HPReal      res( *this ), b( a_other );
+    uint64_t    t = 0;
+
+    res.extend( b.m_frac );
+    b.extend( res.m_frac );
+
+    for ( size_t i = 0; i < res.m_limbs.size(); i++ )
+    {
+        t += (uint64_t)res.m_limbs[i] + b.m_limbs[i];
+        res.m_limbs[i] = (uint32_t)t;
+        t >>= 32;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Subtraction operator
+ * @param a_other - Value to subtract
+ * @return Difference (at highest precision of operands)
+ */
+HPReal
+HPReal::operator-( const HPReal & a_other ) const
+{
+    return *this + -a_other;
+}
+
+/**
+ * @brief Multiplication operator
+ * @param a_other - Value to multiply by
+ * @return Product (at highest precision of operands, truncated)
+ */
+HPReal
+HPReal::operator*( const HPReal & a_other ) const
+{
+    HPReal      a( *this ), b( a_other );
+
+    a.extend( b.m_frac );
+    b.extend( a.m_frac );
+
+    // Multiply magnitudes, then apply sign
+    bool        neg = a.isNegative() != b.isNegative();
+    size_t      n = a.m_limbs.size(), i, j;
+    uint64_t    t;
+
+    if ( a.isNegative() )
+        a.negate();
+    if ( b.isNegative() )
+        b.negate();
+
+    vector<uint32_t> prod( 2*n, 0 );
+
+    for ( i = 0; i < n; i++ )
+    {
+        if ( a.m_limbs[i] == 0 )
+            continue;
+
+        t = 0;
+        for ( j = 0; j < n; j++ )
+        {
+            t += (uint64_t)a.m_limbs[i]*b.m_limbs[j] + prod[i + j];
+            prod[i + j] = (uint32_t)t;
+            t >>= 32;
+        }
+        prod[i + n] = (uint32_t)t;
+    }
+
+    // Product has twice the fraction limbs, drop the least significant
+    copy( prod.begin() + a.m_frac, prod.begin() + a.m_frac + n, a.m_limbs.begin() );
+
+    if ( neg )
+        a.negate();
+
+    return a;
+}
+
+/**
+ * @brief Negation operator
+ * @return Negated value
+ */
+HPReal
+HPReal::operator-() const
+{
+    HPReal res( *this );
+    res.negate();
+    return res;
+}
+
+/**
+ * @brief Converts value to nearest double (within 1 ulp)
+ * @return Double value
+ */
+double
+HPReal::toDouble() const
+{
+    HPReal  a( *this );
+    bool    neg = a.isNegative();
+    double  res = 0;
+
+    if ( neg )
+        a.negate();
+
+    // Only the three most significant non-zero limbs contribute to a double
+    size_t i = a.m_limbs.size();
+    while ( i > 0 && a.m_limbs[i - 1] == 0 )
+        i--;
+
+    for ( size_t j = i > 3 ? i - 3 : 0; j < i; j++ )
+    {
+        res += ldexp( (double)a.m_limbs[j], 32*( (int)j - (int)m_frac ));
+    }
+
+    return neg ? -res : res;
+}
+
+/**
+ * @brief Converts value to a decimal string
+ * @param a_digits - Maximum number of fraction digits
+ * @return Decimal string (trailing zeros removed)
+ */
+string
+HPReal::toString( uint32_t a_digits ) const
+{
+    HPReal      a( *this );
+    bool        neg = a.isNegative();
+    string      res;
+    uint64_t    t;
+    char        buf[16];
+
+    if ( neg )
+        a.negate();
+
+    res = ( neg ? "-" : "" ) + to_string( a.m_limbs[m_frac] ) + ".";
+
+    size_t dot = res.size() - 1;
+
+    // Repeatedly multiply fraction by 10^9 to extract 9 digits at a time
+    while ( res.size() - dot - 1 < a_digits )
+    {
+        t = 0;
+        for ( size_t i = 0; i < m_frac; i++ )
+        {
+            t += (uint64_t)a.m_limbs[i]*1000000000;
+            a.m_limbs[i] = (uint32_t)t;
+            t >>= 32;
+        }
+
+        snprintf( buf, sizeof( buf ), "%09u", (uint32_t)t );
+        res += buf;
+    }
+
+    res.resize( dot + 1 + a_digits );
+
+    while ( res.back() == '0' )
+        res.pop_back();
+
+    if ( res.back() == '.' )
+        res += "0";
+
+    return res;
+}
+
+/**
+ * @brief Determines if value is negative
+ * @return True if negative
+ */
+bool
+HPReal::isNegative() const
+{
+    return m_limbs.back() & 0x80000000;
+}
+
+/**
+ * @brief Increases precision to given number of fraction limbs (no-op if already higher)
+ * @param a_frac_limbs - New number of fraction limbs
+ */
+void
+HPReal::extend( uint16_t a_frac_limbs )
+{
+    if ( a_frac_limbs > m_frac )
+    {
+        m_limbs.insert( m_limbs.begin(), a_frac_limbs - m_frac, 0 );
+        m_frac = a_frac_limbs;
+    }
+}
+
+/**
+ * @brief Negates value in-place (two's complement)
+ */
+void
+HPReal::negate()
+{
+    uint64_t t = 1;
+
+    for ( size_t i = 0; i < m_limbs.size(); i++ )
+    {
+        t += (uint32_t)~m_limbs[i];
+        m_limbs[i] = (uint32_t)t;
+        t >>= 32;
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef HPREAL_H
+#define HPREAL_H
+
+#include <cstdint>
+#include <vector>
+#include <string>
+
+/**
+ * @brief The HPReal class implements an arbitrary precision fixed-point real number
+ *
+ * Values are stored as a two's complement multi-word integer using 32-bit limbs
+ * (least significant first) with an implied binary point. The most significant
+ * limb holds the (signed) integer part; the remaining "fraction" limbs determine
+ * precision. This representation is well suited to Mandelbrot reference orbits
+ * where all values are small in magnitude, and only addition, subtraction, and
+ * multiplication are needed. Overflow of the integer part is not detected.
+ *
+ * Operands of differing precision are extended to the higher precision.
+ */
+class HPReal
+{
+public:
+    HPReal( uint16_t a_frac_limbs = 2 );
+    HPReal( double a_value, uint16_t a_frac_limbs );
+    HPReal( const std::string & a_value, uint16_t a_frac_limbs );
+
+    static uint16_t limbsForBits( int32_t a_bits );
+
+    HPReal      operator+( const HPReal & a_other ) const;
+    HPReal      operator-( const HPReal & a_other ) const;
+    HPReal      operator*( const HPReal & a_other ) const;
+    HPReal      operator-() const;
+
+    double      toDouble() const;
+    std::string toString( uint32_t a_digits ) const;
+    bool        isNegative() const;
+
+    /**
+     * @brief Returns the number of fraction limbs (precision) of this value
+     * @return Fraction limb count
+     */
+    uint16_t
+    fracLimbs() const
+    {
+        return m_frac;
+    }
+
+private:
+    void        extend( uint16_t a_frac_limbs );
+    void        negate();
+
+    std::vector<uint32_t>   m_limbs;    // Two's complement limbs (least significant first)
+    uint16_t                m_frac;     // Number of fraction limbs
+};
+
+#endif // HPREAL_H
@@ -0,0 +1,491 @@
+#include <algorithm>
+#include <cmath>
+#include "imagerenderer.h"
+
+#ifdef CPU_X86
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// Rows per strip (unit of work)
+#define RENDER_ROWS 16
+
+// Max size of color lookup table indexed by count (4 MB), larger iteration limits use palette modulo
+#define LUT_SIZE_MAX 0x100000
+
+// Color of interior pixels (opaque black)
+#define COLOR_INTERIOR 0xFF000000
+
+// Precision of linear light channels, and width of the fields of packed linear colors (see
+// linear). Fields hold the sum of up to 64 samples (supersampling factor 8) without carry.
+#define LINEAR_BITS 14
+#define LINEAR_MAX (( 1 << LINEAR_BITS ) - 1 )
+#define LINEAR_FIELD 21
+
+/**
+ * @brief The Divider struct holds the parameters of division by a constant (multiply and shift)
+ *
+ * For a divisor d >= 2, with l = ceil(log2(d)): magic = floor(2^32*(2^l - d)/d) + 1, and the
+ * quotient of n is (t + ((n - t) >> 1)) >> (l - 1), where t = (n*magic) >> 32. This is exact
+ * for all 32-bit n.
+ */
+struct Divider
+{
+    Divider( uint32_t a_d ):
+        d( a_d )
+    {
+        uint32_t l = 1;
+
+        while (( (uint64_t)1 << l ) < a_d )
+            l++;
+
+        magic = (uint32_t)(((uint64_t)1 << 32 )*((( (uint64_t)1 << l ) - a_d ))/a_d ) + 1;
+        shift = l - 1;
+    }
+
+    uint32_t
+    mod( uint32_t a_n ) const
+    {
+        uint32_t t = ((uint64_t)a_n*magic ) >> 32;
+
+        return a_n - (( t + (( a_n - t ) >> 1 )) >> shift )*d;
+    }
+
+    uint32_t    d;          // Divisor
+    uint32_t    magic;      // Multiplier
+    uint32_t    shift;      // Post shift
+};
+
+/**
+ * @brief Maps a row of counts with a color table
+ * @param a_src - Counts
+ * @param a_dst - Receives colors
+ * @param a_cnt - Pixel count
+ * @param a_lut - Color of each count
+ * @param a_last - Last index of table (larger counts use last color)
+ */
+template<typename T>
+static void
+mapRowTable( const T * a_src, uint32_t * a_dst, uint32_t a_cnt, const uint32_t * a_lut, uint32_t a_last )
+{
+    for ( uint32_t x = 0; x < a_cnt; x++ )
+        a_dst[x] = a_lut[min<uint32_t>( a_src[x], a_last )];
+}
+
+/**
+ * @brief Maps a row of counts with a rotated palette (repeating palettes only)
+ * @param a_src - Counts
+ * @param a_dst - Receives colors
+ * @param a_cnt - Pixel count
+ * @param a_lut - Palette colors rotated by offset
+ * @param a_div - Divider by palette size
+ */
+template<typename T>
+static void
+mapRowModulo( const T * a_src, uint32_t * a_dst, uint32_t a_cnt, const uint32_t * a_lut, const Divider & a_div )
+{
+    for ( uint32_t x = 0; x < a_cnt; x++ )
+    {
+        uint32_t it = a_src[x];
+
+        a_dst[x] = it ? a_lut[a_div.mod( it )] : COLOR_INTERIOR;
+    }
+}
+
+/**
+ * @brief Adds the linear colors of a row of counts to column sums (downscaling)
+ * @param a_src - Counts
+ * @param a_sum - Column sums (packed linear colors)
+ * @param a_cnt - Count of columns
+ * @param a_lin - Linear color of each table entry
+ * @param a_last - Last index of table (table mode)
+ * @param a_div - Divider by table size (modulo mode)
+ *
+ * In modulo mode the table is the rotated palette (see mapRowModulo), otherwise it is
+ * indexed by count (see mapRowTable).
+ */
+template<bool MODULO, typename T>
+static void
+sumRowLinear( const T * a_src, uint64_t * a_sum, uint32_t a_cnt, const uint64_t * a_lin, uint32_t a_last, const Divider & a_div )
+{
+    for ( uint32_t x = 0; x < a_cnt; x++ )
+    {
+        uint32_t it = a_src[x];
+
+        // Interior color (black) is 0 in linear light
+        if ( MODULO )
+            a_sum[x] += it ? a_lin[a_div.mod( it )] : 0;
+        else
+            a_sum[x] += a_lin[min( it, a_last )];
+    }
+}
+
+#ifdef CPU_X86
+
+/**
+ * @brief Loads 8 counts as 32-bit lanes
+ * @param a_src - Counts
+ * @return Vector of counts
+ */
+CPU_TARGET_AVX2 static inline __m256i
+load8( const uint16_t * a_src )
+{
+    return _mm256_cvtepu16_epi32( _mm_loadu_si128( (const __m128i*)a_src ));
+}
+
+CPU_TARGET_AVX2 static inline __m256i
+load8( const uint32_t * a_src )
+{
+    return _mm256_loadu_si256( (const __m256i*)a_src );
+}
+
+/**
+ * @brief Vectorized (AVX2) version of mapRowTable
+ */
+template<typename T>
+CPU_TARGET_AVX2 static void
+mapRowTableAVX2( const T * a_src, uint32_t * a_dst, uint32_t a_cnt, const uint32_t * a_lut, uint32_t a_last )
+{
+    const __m256i   last = _mm256_set1_epi32( a_last );
+    uint32_t        x = 0;
+
+    for ( ; x + 8 <= a_cnt; x += 8 )
+    {
+        __m256i idx = _mm256_min_epu32( load8( a_src + x ), last );
+
+        _mm256_storeu_si256( (__m256i*)( a_dst + x ), _mm256_i32gather_epi32( (const int*)a_lut, idx, 4 ));
+    }
+
+    mapRowTable( a_src + x, a_dst + x, a_cnt - x, a_lut, a_last );
+}
+
+/**
+ * @brief Vectorized (AVX2) version of sumRowLinear (table mode)
+ */
+template<typename T>
+CPU_TARGET_AVX2 static void
+sumRowLinearAVX2( const T * a_src, uint64_t * a_sum, uint32_t a_cnt, const uint64_t * a_lin, uint32_t a_last, const Divider & a_div )
+{
+    const __m256i   last = _mm256_set1_epi32( a_last );
+    uint32_t        x = 0;
+
+    for ( ; x + 8 <= a_cnt; x += 8 )
+    {
+        __m256i idx = _mm256_min_epu32( load8( a_src + x ), last );
+        __m256i lo = _mm256_i64gather_epi64( (const long long*)a_lin, _mm256_cvtepu32_epi64( _mm256_castsi256_si128( idx )), 8 );
+        __m256i hi = _mm256_i64gather_epi64( (const long long*)a_lin, _mm256_cvtepu32_epi64( _mm256_extracti128_si256( idx, 1 )), 8 );
+
+        _mm256_storeu_si256( (__m256i*)( a_sum + x ), _mm256_add_epi64( _mm256_loadu_si256( (const __m256i*)( a_sum + x )), lo ));
+        _mm256_storeu_si256( (__m256i*)( a_sum + x + 4 ), _mm256_add_epi64( _mm256_loadu_si256( (const __m256i*)( a_sum + x + 4 )), hi ));
+    }
+
+    sumRowLinear<false>( a_src + x, a_sum + x, a_cnt - x, a_lin, a_last, a_div );
+}
+
+/**
+ * @brief Vectorized (AVX2) version of mapRowModulo
+ *
+ * The palette index is computed with vector division by the palette size (see Divider).
+ */
+template<typename T>
+CPU_TARGET_AVX2 static void
+mapRowModuloAVX2( const T * a_src, uint32_t * a_dst, uint32_t a_cnt, const uint32_t * a_lut, const Divider & a_div )
+{
+    const __m256i   magic = _mm256_set1_epi32( a_div.magic );
+    const __m256i   d = _mm256_set1_epi32( a_div.d );
+    const __m128i   shift = _mm_cvtsi32_si128( a_div.shift );
+    const __m256i   zero = _mm256_setzero_si256();
+    const __m256i   interior = _mm256_set1_epi32( COLOR_INTERIOR );
+    uint32_t        x = 0;
+
+    for ( ; x + 8 <= a_cnt; x += 8 )
+    {
+        __m256i n = load8( a_src + x );
+
+        // High 32 bits of n*magic (even and odd lanes multiplied separately)
+        __m256i t_even = _mm256_srli_epi64( _mm256_mul_epu32( n, magic ), 32 );
+        __m256i t_odd = _mm256_mul_epu32( _mm256_srli_epi64( n, 32 ), magic );
+        __m256i t = _mm256_blend_epi32( t_even, t_odd, 0xAA );
+
+        __m256i q = _mm256_srl_epi32( _mm256_add_epi32( t, _mm256_srli_epi32( _mm256_sub_epi32( n, t ), 1 )), shift );
+        __m256i idx = _mm256_sub_epi32( n, _mm256_mullo_epi32( q, d ));
+        __m256i col = _mm256_i32gather_epi32( (const int*)a_lut, idx, 4 );
+
+        col = _mm256_blendv_epi8( col, interior, _mm256_cmpeq_epi32( n, zero ));
+        _mm256_storeu_si256( (__m256i*)( a_dst + x ), col );
+    }
+
+    mapRowModulo( a_src + x, a_dst + x, a_cnt - x, a_lut, a_div );
+}
+
+#endif
+
+/**
+ * @brief ImageRenderer constructor - starts thread pool and detects SIMD support
+ */
+ImageRenderer::ImageRenderer():
+    m_simd_level( CpuFeatures::simdLevel() ),
+    m_lut_repeat( false ),
+    m_lut_offset( 0 ),
+    m_lut_iter_mx( 0 ),
+    m_lut_modulo( false ),
+    m_to_srgb( LINEAR_MAX + 1 )
+{
+    // sRGB transfer function tables
+    for ( uint32_t v = 0; v < 256; v++ )
+    {
+        double c = v/255.0;
+
+        c = c <= 0.04045 ? c/12.92 : pow(( c + 0.055 )/1.055, 2.4 );
+        m_to_linear[v] = lround( c*LINEAR_MAX );
+    }
+
+    for ( uint32_t l = 0; l <= LINEAR_MAX; l++ )
+    {
+        double c = (double)l/LINEAR_MAX;
+
+        c = c <= 0.0031308 ? c*12.92 : 1.055*pow( c, 1/2.4 ) - 0.055;
+        m_to_srgb[l] = lround( c*255 );
+    }
+}
+
+/**
+ * @brief Renders iteration counts to an image
+ * @param a_data - Iteration counts (bottom row first)
+ * @param a_width - Image width
+ * @param a_height - Image height
+ * @param a_iter_mx - Iteration limit of counts
+ * @param a_palette - Palette colors (not empty)
+ * @param a_repeat - Palette repeats (otherwise counts beyond palette use last color)
+ * @param a_offset - Palette offset
+ * @param a_ss - Supersampling factor of counts (1 to 8)
+ * @param a_image - Receives ARGB image (top row first, width/ss x height/ss)
+ *
+ * The y-axis is reversed due to difference in mathematical and graphical origin. If
+ * supersampled, each image pixel is the average of the colors of ss x ss counts in linear
+ * light (see downscale), thus the full resolution image is never rendered.
+ */
+void
+ImageRenderer::render( const IterBuffer & a_data, uint16_t a_width, uint16_t a_height, uint32_t a_iter_mx,
+                       const vector<uint32_t> & a_palette, bool a_repeat, uint32_t a_offset, uint8_t a_ss,
+                       uint32_t * a_image )
+{
+    buildLut( a_iter_mx, a_palette, a_repeat, a_offset );
+
+    if ( a_ss > 1 )
+    {
+        downscale( a_data, a_width, a_height, a_ss, a_image );
+        return;
+    }
+
+    const uint32_t *    lut = m_lut.data();
+    uint32_t            last = m_lut.size() - 1;
+    Divider             div( max<uint32_t>( m_lut.size(), 2 ));
+    bool                modulo = m_lut_modulo;
+#ifdef CPU_X86
+    bool                simd = m_simd_level >= CpuFeatures::SIMD_AVX2;
+#endif
+
+    a_data.visit( [&]( const auto * a_buf )
+    {
+        m_pool.run(( a_height + RENDER_ROWS - 1 )/RENDER_ROWS, [&]( uint32_t a_strip )
+        {
+            uint32_t y_end = min<uint32_t>(( a_strip + 1 )*RENDER_ROWS, a_height );
+
+            for ( uint32_t y = a_strip*RENDER_ROWS; y < y_end; y++ )
+            {
+                const auto *    src = a_buf + (size_t)y*a_width;
+                uint32_t *      dst = a_image + (size_t)( a_height - 1 - y )*a_width;
+
+#ifdef CPU_X86
+                if ( simd )
+                {
+                    if ( modulo )
+                        mapRowModuloAVX2( src, dst, a_width, lut, div );
+                    else
+                        mapRowTableAVX2( src, dst, a_width, lut, last );
+                    continue;
+                }
+#endif
+                if ( modulo )
+                    mapRowModulo( src, dst, a_width, lut, div );
+                else
+                    mapRowTable( src, dst, a_width, lut, last );
+            }
+        });
+    });
+}
+
+/**
+ * @brief Renders supersampled iteration counts to a downscaled image
+ * @param a_data - Iteration counts (bottom row first)
+ * @param a_width - Width of counts
+ * @param a_height - Height of counts
+ * @param a_ss - Supersampling factor (2 to 8)
+ * @param a_image - Receives ARGB image (top row first, width/ss x height/ss)
+ *
+ * Colors are looked up and averaged (box filter) in linear light in a single pass over
+ * the counts. Each output row sums the linear colors of its ss count rows per column, then
+ * sums ss columns per output pixel and converts the averages back to sRGB. Counts beyond a
+ * multiple of ss (right columns and top rows of image) are not rendered.
+ */
+void
+ImageRenderer::downscale( const IterBuffer & a_data, uint16_t a_width, uint16_t a_height, uint8_t a_ss, uint32_t * a_image )
+{
+    // Linear colors of table entries
+    if ( m_lut_lin.size() != m_lut.size() )
+    {
+        m_lut_lin.resize( m_lut.size() );
+
+        for ( size_t i = 0; i < m_lut.size(); i++ )
+            m_lut_lin[i] = linear( m_lut[i] );
+    }
+
+    const uint64_t *    lin = m_lut_lin.data();
+    const uint8_t *     to_srgb = m_to_srgb.data();
+    uint32_t            last = m_lut_lin.size() - 1;
+    Divider             div( max<uint32_t>( m_lut_lin.size(), 2 ));
+    bool                modulo = m_lut_modulo;
+    uint32_t            width = a_width/a_ss;
+    uint32_t            height = a_height/a_ss;
+    uint32_t            samples = a_ss*a_ss;
+    uint64_t            recip = (( 1ULL << 32 ) + samples - 1 )/samples; // Exact division of sums (< 2^21)
+    uint32_t            rows = max( RENDER_ROWS/a_ss, 1 );
+#ifdef CPU_X86
+    bool                simd = m_simd_level >= CpuFeatures::SIMD_AVX2;
+#endif
+
+    a_data.visit( [&]( const auto * a_buf )
+    {
+        m_pool.run(( height + rows - 1 )/rows, [&]( uint32_t a_strip )
+        {
+            vector<uint64_t>    sum( width*a_ss );
+            uint32_t            y_end = min(( a_strip + 1 )*rows, height );
+
+            for ( uint32_t y = a_strip*rows; y < y_end; y++ )
+            {
+                fill( sum.begin(), sum.end(), 0 );
+
+                for ( uint32_t k = 0; k < a_ss; k++ )
+                {
+                    const auto * src = a_buf + (size_t)( a_height - 1 - ( y*a_ss + k ))*a_width;
+
+#ifdef CPU_X86
+                    if ( simd && !modulo )
+                    {
+                        sumRowLinearAVX2( src, sum.data(), sum.size(), lin, last, div );
+                        continue;
+                    }
+#endif
+                    if ( modulo )
+                        sumRowLinear<true>( src, sum.data(), sum.size(), lin, last, div );
+                    else
+                        sumRowLinear<false>( src, sum.data(), sum.size(), lin, last, div );
+                }
+
+                uint32_t * dst = a_image + (size_t)y*width;
+
+                for ( uint32_t x = 0; x < width; x++ )
+                {
+                    uint64_t    s = 0;
+                    uint32_t    color = 0xFF000000;
+
+                    for ( uint32_t i = x*a_ss; i < ( x + 1 )*a_ss; i++ )
+                        s += sum[i];
+
+                    for ( uint32_t f = 0; f < 3; f++ )
+                    {
+                        uint32_t c = ( s >> ( f*LINEAR_FIELD )) & (( 1 << LINEAR_FIELD ) - 1 );
+
+                        color |= (uint32_t)to_srgb[(( c + samples/2 )*recip ) >> 32] << ( f*8 );
+                    }
+
+                    dst[x] = color;
+                }
+            }
+        });
+    });
+}
+
+/**
+ * @brief Converts a color to packed linear light channels
+ * @param a_color - ARGB color
+ * @return Red, green and blue (LINEAR_BITS each) in LINEAR_FIELD bit fields (blue lowest)
+ */
+uint64_t
+ImageRenderer::linear( uint32_t a_color ) const
+{
+    return ((uint64_t)m_to_linear[( a_color >> 16 ) & 0xFF] << ( 2*LINEAR_FIELD )) |
+           ((uint64_t)m_to_linear[( a_color >> 8 ) & 0xFF] << LINEAR_FIELD ) |
+           m_to_linear[a_color & 0xFF];
+}
+
+/**
+ * @brief Builds the color lookup table, unless built for the same palette, offset and iteration limit
+ * @param a_iter_mx - Iteration limit of counts
+ * @param a_palette - Palette colors (not empty)
+ * @param a_repeat - Palette repeats
+ * @param a_offset - Palette offset
+ *
+ * The table holds the color of each count (including interior count 0), thus rendering
+ * is a single load per pixel. For a clamped palette the table extends the palette by
+ * the offset (counts beyond the table use its last color). For a repeating palette the
+ * table covers all counts up to the iteration limit, or if that exceeds LUT_SIZE_MAX,
+ * the table is the palette rotated by the offset and is indexed by count modulo palette
+ * size instead.
+ */
+void
+ImageRenderer::buildLut( uint32_t a_iter_mx, const vector<uint32_t> & a_palette, bool a_repeat, uint32_t a_offset )
+{
+    // A single color palette is the same clamped
+    a_repeat = a_repeat && a_palette.size() > 1;
+
+    if ( m_lut.size() && a_repeat == m_lut_repeat && a_offset == m_lut_offset &&
+         ( !a_repeat || a_iter_mx == m_lut_iter_mx ) && a_palette == m_lut_palette )
+        return;
+
+    uint32_t    pal_size = a_palette.size();
+    uint32_t    j;
+
+    m_lut_palette = a_palette;
+    m_lut_repeat = a_repeat;
+    m_lut_offset = a_offset;
+    m_lut_iter_mx = a_iter_mx;
+    m_lut_modulo = a_repeat && a_iter_mx >= LUT_SIZE_MAX;
+    m_lut_lin.clear();
+
+    if ( m_lut_modulo )
+    {
+        m_lut.resize( pal_size );
+        j = a_offset % pal_size;
+
+        for ( uint32_t i = 0; i < pal_size; i++ )
+        {
+            m_lut[i] = a_palette[j];
+            if ( ++j == pal_size )
+                j = 0;
+        }
+    }
+    else if ( a_repeat )
+    {
+        m_lut.resize( (size_t)a_iter_mx + 1 );
+        m_lut[0] = COLOR_INTERIOR;
+        j = ( a_offset + 1 ) % pal_size;
+
+        for ( uint32_t i = 1; i <= a_iter_mx; i++ )
+        {
+            m_lut[i] = a_palette[j];
+            if ( ++j == pal_size )
+                j = 0;
+        }
+    }
+    else
+    {
+        m_lut.resize( max<size_t>( (size_t)a_offset + pal_size, 2 ));
+        m_lut[0] = COLOR_INTERIOR;
+
+        for ( uint32_t i = 1; i < m_lut.size(); i++ )
+            m_lut[i] = a_palette[min( max( i, a_offset ) - a_offset, pal_size - 1 )];
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef IMAGERENDERER_H
+#define IMAGERENDERER_H
+
+#include <cstdint>
+#include <vector>
+#include "iterbuffer.h"
+#include "cpufeatures.h"
+#include "threadpool.h"
+
+/**
+ * @brief The ImageRenderer class maps iteration counts to image colors using a palette
+ *
+ * The image is rendered in row strips on a thread pool. Colors are looked up in a table
+ * indexed by count, which is built from the palette, offset and iteration limit, and kept
+ * until these change (see buildLut). Rows are mapped by functions with vectorized (AVX2)
+ * versions that look up the colors of 8 pixels at once (gather). Interior pixels (count
+ * of 0) are rendered black. Supersampled counts are colored and downscaled in the same
+ * pass (see downscale).
+ */
+class ImageRenderer
+{
+public:
+    ImageRenderer();
+
+    void    render( const IterBuffer & a_data, uint16_t a_width, uint16_t a_height, uint32_t a_iter_mx,
+                    const std::vector<uint32_t> & a_palette, bool a_repeat, uint32_t a_offset, uint8_t a_ss,
+                    uint32_t * a_image );
+
+private:
+    void        buildLut( uint32_t a_iter_mx, const std::vector<uint32_t> & a_palette, bool a_repeat, uint32_t a_offset );
+    void        downscale( const IterBuffer & a_data, uint16_t a_width, uint16_t a_height, uint8_t a_ss, uint32_t * a_image );
+    uint64_t    linear( uint32_t a_color ) const;
+
+    ThreadPool              m_pool;
+    CpuFeatures::SimdLevel  m_simd_level;   // Detected SIMD support
+    std::vector<uint32_t>   m_lut;          // Color lookup table
+    std::vector<uint32_t>   m_lut_palette;  // Palette of table
+    bool                    m_lut_repeat;   // Palette of table repeats
+    uint32_t                m_lut_offset;   // Palette offset of table
+    uint32_t                m_lut_iter_mx;  // Iteration limit of table
+    bool                    m_lut_modulo;   // Table is rotated palette (indexed by count modulo palette size)
+    std::vector<uint64_t>   m_lut_lin;      // Linear light colors of table (built on first downscale)
+    uint16_t                m_to_linear[256]; // sRGB channel to linear light
+    std::vector<uint8_t>    m_to_srgb;      // Linear light channel to sRGB
+};
+
+#endif // IMAGERENDERER_H
@@ -0,0 +1,164 @@
+#ifndef ITERBUFFER_H
+#define ITERBUFFER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief The IterBuffer class holds the iteration counts of an image as 16 or 32-bit values
+ *
+ * Iteration counts never exceed the iteration limit, thus counts are stored as 16-bit
+ * values when the limit allows (see fits16), halving memory and bandwidth, and as 32-bit
+ * values otherwise. The width is chosen at run time when the buffer is sized. Element
+ * access (operator[] and set) selects the width per access, while bulk operations use
+ * the typed data (see visit).
+ */
+class IterBuffer
+{
+public:
+    IterBuffer():
+        m_wide( true )
+    {}
+
+    /**
+     * @brief Checks if counts up to an iteration limit can be stored as 16-bit values
+     * @param a_iter_mx - Iteration limit
+     * @return True if 16-bit
+     */
+    static bool
+    fits16( uint32_t a_iter_mx )
+    {
+        return a_iter_mx < 0xFFFF;
+    }
+
+    /**
+     * @brief Sizes the buffer (contents are zeroed)
+     * @param a_cnt - Number of counts
+     * @param a_wide - True for 32-bit counts, false for 16-bit counts
+     */
+    void
+    assign( size_t a_cnt, bool a_wide )
+    {
+        m_wide = a_wide;
+
+        if ( a_wide )
+        {
+            std::vector<uint16_t>().swap( m_data16 );
+            m_data32.assign( a_cnt, 0 );
+        }
+        else
+        {
+            std::vector<uint32_t>().swap( m_data32 );
+            m_data16.assign( a_cnt, 0 );
+        }
+    }
+
+    /**
+     * @brief Releases the buffer (width is kept)
+     */
+    void
+    clear()
+    {
+        std::vector<uint16_t>().swap( m_data16 );
+        std::vector<uint32_t>().swap( m_data32 );
+    }
+
+    /**
+     * @brief Exchanges contents (and width) with another buffer
+     * @param a_other - Other buffer
+     */
+    void
+    swap( IterBuffer & a_other )
+    {
+        m_data16.swap( a_other.m_data16 );
+        m_data32.swap( a_other.m_data32 );
+        std::swap( m_wide, a_other.m_wide );
+    }
+
+    bool
+    wide() const
+    {
+        return m_wide;
+    }
+
+    size_t
+    size() const
+    {
+        return m_wide ? m_data32.size() : m_data16.size();
+    }
+
+    bool
+    empty() const
+    {
+        return size() == 0;
+    }
+
+    /**
+     * @brief Returns the size of the buffer in bytes
+     * @return Byte count
+     */
+    size_t
+    bytes() const
+    {
+        return m_wide ? m_data32.size()*sizeof( uint32_t ) : m_data16.size()*sizeof( uint16_t );
+    }
+
+    void *
+    data()
+    {
+        return m_wide ? (void*)m_data32.data() : (void*)m_data16.data();
+    }
+
+    const void *
+    data() const
+    {
+        return m_wide ? (const void*)m_data32.data() : (const void*)m_data16.data();
+    }
+
+    uint32_t
+    operator[]( size_t a_idx ) const
+    {
+        return m_wide ? m_data32[a_idx] : m_data16[a_idx];
+    }
+
+    void
+    set( size_t a_idx, uint32_t a_value )
+    {
+        if ( m_wide )
+            m_data32[a_idx] = a_value;
+        else
+            m_data16[a_idx] = (uint16_t)a_value;
+    }
+
+    /**
+     * @brief Calls a function with a pointer to the typed counts
+     * @param a_func - Function (generic lambda) taking a uint16_t or uint32_t pointer
+     */
+    template<typename F>
+    void
+    visit( F && a_func )
+    {
+        if ( m_wide )
+            a_func( m_data32.data() );
+        else
+            a_func( m_data16.data() );
+    }
+
+    template<typename F>
+    void
+    visit( F && a_func ) const
+    {
+        if ( m_wide )
+            a_func( (const uint32_t*)m_data32.data() );
+        else
+            a_func( (const uint16_t*)m_data16.data() );
+    }
+
+private:
+    std::vector<uint16_t>   m_data16;   // 16-bit counts (empty if wide)
+    std::vector<uint32_t>   m_data32;   // 32-bit counts (empty if not wide)
+    bool                    m_wide;     // Counts are 32-bit
+};
+
+#endif // ITERBUFFER_H
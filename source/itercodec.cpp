@@ -0,0 +1,454 @@
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include "itercodec.h"
+
+using namespace std;
+
+// Encoded data marker ("MBC1")
+#define CODEC_MAGIC 0x3143424D
+
+// Max and min pixel counts of a strip (rounded up to whole rows)
+#define STRIP_PIXELS_MAX 0x40000
+#define STRIP_PIXELS_MIN 0x10000
+
+// Prediction errors (zigzag encoded) below ESCAPE are coded as a single token, larger
+// errors as token ESCAPE + n - 1 followed by n raw bytes of (error - ESCAPE)
+#define ESCAPE 240
+#define TOKEN_CNT ( ESCAPE + 4 )
+
+// rANS frequency scale (bits) and lower bound of coder state
+#define RANS_SCALE_BITS 12
+#define RANS_SCALE ( 1 << RANS_SCALE_BITS )
+#define RANS_L ( 1u << 23 )
+
+/**
+ * @brief The StripHeader struct is the header of an encoded strip
+ *
+ * The header is followed by the token frequencies (uint16_t each), the raw bytes of escaped
+ * errors, then the rANS coded tokens.
+ */
+struct StripHeader
+{
+    uint32_t    raw_len;        // Length of raw bytes
+    uint16_t    sym_cnt;        // Number of token frequencies (max token + 1)
+    uint16_t    reserved;
+};
+
+/**
+ * @brief Predicts a count from its neighbors (median edge detector)
+ * @param a - Left count
+ * @param b - Upper count
+ * @param c - Upper-left count
+ * @return Predicted count
+ */
+static inline uint32_t
+predict( uint32_t a, uint32_t b, uint32_t c )
+{
+    uint32_t mn = min( a, b ), mx = max( a, b );
+
+    return c >= mx ? mn : ( c <= mn ? mx : a + b - c );
+}
+
+/**
+ * @brief Runs a function for items in parallel (items are claimed in order)
+ * @param a_cnt - Item count
+ * @param a_th_cnt - Thread count (0 = hardware concurrency)
+ * @param a_func - Function called with item index
+ */
+static void
+parallel( uint32_t a_cnt, unsigned a_th_cnt, const function<void( uint32_t )> & a_func )
+{
+    atomic<uint32_t>    next( 0 );
+    vector<thread>      threads;
+    unsigned            th_cnt = min<unsigned>( a_th_cnt ? a_th_cnt : max( thread::hardware_concurrency(), 1u ), a_cnt );
+
+    auto work = [&]()
+    {
+        for ( uint32_t i; ( i = next++ ) < a_cnt; )
+            a_func( i );
+    };
+
+    for ( unsigned t = 1; t < th_cnt; t++ )
+        threads.emplace_back( work );
+
+    work();
+
+    for ( thread & t : threads )
+        t.join();
+}
+
+/**
+ * @brief Scales token counts to frequencies summing to RANS_SCALE
+ * @param a_cnt - Token counts
+ * @param a_sym_cnt - Number of tokens
+ * @param a_total - Sum of counts (not 0)
+ * @param a_freq - Receives frequencies (every used token gets at least 1)
+ */
+static void
+normalize( const uint32_t * a_cnt, uint32_t a_sym_cnt, size_t a_total, uint16_t * a_freq )
+{
+    uint32_t    sum = 0, top = 0;
+
+    for ( uint32_t s = 0; s < a_sym_cnt; s++ )
+    {
+        a_freq[s] = a_cnt[s] ? max<uint32_t>((uint64_t)a_cnt[s]*RANS_SCALE/a_total, 1 ) : 0;
+        sum += a_freq[s];
+
+        if ( a_cnt[s] > a_cnt[top] )
+            top = s;
+    }
+
+    if ( sum <= RANS_SCALE )
+    {
+        a_freq[top] += RANS_SCALE - sum;
+        return;
+    }
+
+    // Rounding up of rare tokens exceeded scale, take from largest frequencies
+    while ( sum > RANS_SCALE )
+    {
+        top = max_element( a_freq, a_freq + a_sym_cnt ) - a_freq;
+        a_freq[top]--;
+        sum--;
+    }
+}
+
+/**
+ * @brief Encodes a strip
+ * @param a_data - Counts of strip
+ * @param a_width - Image width
+ * @param a_rows - Rows in strip
+ * @param a_out - Receives encoded strip
+ */
+template<typename T>
+static void
+encodeStrip( const T * a_data, uint32_t a_width, uint32_t a_rows, vector<uint8_t> & a_out )
+{
+    size_t          n = (size_t)a_width*a_rows;
+    vector<uint8_t> tokens( n );
+    vector<uint8_t> raw;
+    uint32_t        cnt[TOKEN_CNT] = {};
+    uint32_t        sym_cnt = 1;
+
+    // Predict counts and tokenize zigzag encoded errors
+    auto tokenize = [&]( size_t a_idx, uint32_t a_pred )
+    {
+        uint32_t e = (uint32_t)a_data[a_idx] - a_pred;
+        uint32_t z = ( e << 1 ) ^ (uint32_t)((int32_t)e >> 31 );
+        uint8_t  tok;
+
+        if ( z < ESCAPE )
+        {
+            tok = z;
+        }
+        else
+        {
+            z -= ESCAPE;
+            tok = ESCAPE;
+
+            for ( raw.push_back( z ); z >>= 8; tok++ )
+                raw.push_back( z );
+        }
+
+        tokens[a_idx] = tok;
+        cnt[tok]++;
+        sym_cnt = max<uint32_t>( sym_cnt, tok + 1 );
+    };
+
+    for ( uint32_t x = 0; x < a_width; x++ )
+        tokenize( x, x ? a_data[x-1] : 0 );
+
+    for ( size_t row = a_width; row < n; row += a_width )
+    {
+        tokenize( row, a_data[row-a_width] );
+
+        for ( size_t i = row + 1; i < row + a_width; i++ )
+            tokenize( i, predict( a_data[i-1], a_data[i-a_width], a_data[i-a_width-1] ));
+    }
+
+    uint16_t freq[TOKEN_CNT];
+    uint32_t start[TOKEN_CNT];
+
+    normalize( cnt, sym_cnt, n, freq );
+
+    for ( uint32_t s = 0, c = 0; s < sym_cnt; c += freq[s++] )
+        start[s] = c;
+
+    // rANS encode tokens in reverse order (into end of buffer) with two interleaved states
+    vector<uint8_t> buf( 2*n + 8 );
+    uint8_t *       ptr = buf.data() + buf.size();
+    uint32_t        st[2] = { RANS_L, RANS_L };
+
+    for ( size_t i = n; i-- > 0; )
+    {
+        uint32_t &  x = st[i & 1];
+        uint32_t    f = freq[tokens[i]];
+        uint32_t    x_mx = (( RANS_L >> RANS_SCALE_BITS ) << 8 )*f;
+
+        while ( x >= x_mx )
+        {
+            *--ptr = x;
+            x >>= 8;
+        }
+
+        x = (( x / f ) << RANS_SCALE_BITS ) + ( x % f ) + start[tokens[i]];
+    }
+
+    // Final states, first state first
+    ptr -= 8;
+    memcpy( ptr, &st[0], 4 );
+    memcpy( ptr + 4, &st[1], 4 );
+
+    StripHeader hdr = { (uint32_t)raw.size(), (uint16_t)sym_cnt, 0 };
+    size_t      rans_len = buf.data() + buf.size() - ptr;
+
+    a_out.resize( sizeof( hdr ) + sym_cnt*sizeof( uint16_t ) + raw.size() + rans_len );
+
+    uint8_t * out = a_out.data();
+
+    memcpy( out, &hdr, sizeof( hdr ));
+    out += sizeof( hdr );
+    memcpy( out, freq, sym_cnt*sizeof( uint16_t ));
+    out += sym_cnt*sizeof( uint16_t );
+    if ( raw.size() )
+        memcpy( out, raw.data(), raw.size() );
+    out += raw.size();
+    memcpy( out, ptr, rans_len );
+}
+
+/**
+ * @brief Decodes a strip
+ * @param a_in - Encoded strip
+ * @param a_len - Length of encoded strip
+ * @param a_data - Receives counts of strip
+ * @param a_width - Image width
+ * @param a_rows - Rows in strip
+ * @return True if decoded, false if encoded strip is invalid
+ */
+template<typename T>
+static bool
+decodeStrip( const uint8_t * a_in, size_t a_len, T * a_data, uint32_t a_width, uint32_t a_rows )
+{
+    StripHeader hdr;
+
+    if ( a_len < sizeof( hdr ))
+        return false;
+
+    memcpy( &hdr, a_in, sizeof( hdr ));
+
+    if ( hdr.sym_cnt > TOKEN_CNT || a_len < sizeof( hdr ) + hdr.sym_cnt*sizeof( uint16_t ) + hdr.raw_len + 8 )
+        return false;
+
+    const uint8_t * end = a_in + a_len;
+    const uint8_t * raw = a_in + sizeof( hdr ) + hdr.sym_cnt*sizeof( uint16_t );
+    const uint8_t * ptr = raw + hdr.raw_len;
+
+    // Build slot lookup tables (token, frequency and offset in token range per slot)
+    uint16_t    freq[TOKEN_CNT];
+    uint8_t     slot_sym[RANS_SCALE];
+    uint16_t    slot_freq[RANS_SCALE];
+    uint16_t    slot_off[RANS_SCALE];
+    uint32_t    slot = 0;
+
+    memcpy( freq, a_in + sizeof( hdr ), hdr.sym_cnt*sizeof( uint16_t ));
+
+    for ( uint32_t s = 0; s < hdr.sym_cnt; s++ )
+    {
+        if ( slot + freq[s] > RANS_SCALE )
+            return false;
+
+        for ( uint32_t j = 0; j < freq[s]; j++, slot++ )
+        {
+            slot_sym[slot] = s;
+            slot_freq[slot] = freq[s];
+            slot_off[slot] = j;
+        }
+    }
+
+    if ( slot != RANS_SCALE )
+        return false;
+
+    uint32_t x0, x1;
+
+    memcpy( &x0, ptr, 4 );
+    memcpy( &x1, ptr + 4, 4 );
+    ptr += 8;
+
+    const uint8_t * raw_end = raw + hdr.raw_len;
+    bool            ok = true;
+
+    // Decodes next error (states alternate per token)
+    auto next = [&]() -> uint32_t
+    {
+        uint32_t s = x0 & ( RANS_SCALE - 1 );
+        uint32_t tok = slot_sym[s];
+
+        x0 = slot_freq[s]*( x0 >> RANS_SCALE_BITS ) + slot_off[s];
+
+        while ( x0 < RANS_L && ptr < end )
+            x0 = ( x0 << 8 ) | *ptr++;
+
+        swap( x0, x1 );
+
+        uint32_t z = tok;
+
+        if ( tok >= ESCAPE )
+        {
+            uint32_t nb = tok - ESCAPE + 1;
+
+            if ( (uint32_t)( raw_end - raw ) < nb )
+            {
+                ok = false;
+                return 0;
+            }
+
+            z = 0;
+            for ( uint32_t b = 0; b < nb; b++ )
+                z |= (uint32_t)*raw++ << ( 8*b );
+
+            z += ESCAPE;
+        }
+
+        return ( z >> 1 ) ^ ( 0 - ( z & 1 ));
+    };
+
+    size_t n = (size_t)a_width*a_rows;
+
+    for ( uint32_t x = 0; x < a_width; x++ )
+        a_data[x] = ( x ? a_data[x-1] : 0 ) + next();
+
+    for ( size_t row = a_width; row < n; row += a_width )
+    {
+        a_data[row] = a_data[row-a_width] + next();
+
+        for ( size_t i = row + 1; i < row + a_width; i++ )
+            a_data[i] = predict( a_data[i-1], a_data[i-a_width], a_data[i-a_width-1] ) + next();
+    }
+
+    return ok && raw == raw_end;
+}
+
+/**
+ * @brief Encodes an iteration buffer
+ * @param a_data - Iteration buffer
+ * @param a_width - Image width (buffer size must be a multiple)
+ * @param a_out - Receives encoded data
+ * @param a_th_cnt - Thread count (0 = hardware concurrency)
+ */
+void
+IterCodec::encode( const IterBuffer & a_data, uint16_t a_width, vector<uint8_t> & a_out, unsigned a_th_cnt )
+{
+    Header hdr;
+
+    memset( &hdr, 0, sizeof( hdr ));
+    hdr.magic = CODEC_MAGIC;
+    hdr.width = a_width;
+    hdr.height = a_width ? a_data.size()/a_width : 0;
+    hdr.wide = a_data.wide();
+
+    // Strips are sized for parallelism (two per thread), but are not made too small for entropy coding
+    unsigned th_cnt = a_th_cnt ? a_th_cnt : max( thread::hardware_concurrency(), 1u );
+    uint32_t width = max<uint32_t>( a_width, 1 );
+    uint32_t rows = ( hdr.height + 2*th_cnt - 1 )/( 2*th_cnt );
+
+    rows = max<uint32_t>( rows, ( STRIP_PIXELS_MIN + width - 1 )/width );
+    rows = min<uint32_t>( rows, ( STRIP_PIXELS_MAX + width - 1 )/width );
+    hdr.strip_rows = min<uint32_t>( rows, 0xFFFF );
+    hdr.strip_cnt = ( hdr.height + hdr.strip_rows - 1 )/hdr.strip_rows;
+
+    vector<vector<uint8_t>> strips( hdr.strip_cnt );
+
+    a_data.visit( [&]( const auto * a_buf )
+    {
+        parallel( hdr.strip_cnt, a_th_cnt, [&]( uint32_t a_strip )
+        {
+            uint32_t row = a_strip*hdr.strip_rows;
+
+            encodeStrip( a_buf + (size_t)row*a_width, a_width, min<uint32_t>( hdr.strip_rows, hdr.height - row ), strips[a_strip] );
+        });
+    });
+
+    size_t              len = sizeof( hdr ) + hdr.strip_cnt*sizeof( uint64_t );
+    vector<uint64_t>    ends( hdr.strip_cnt );
+
+    for ( uint32_t s = 0; s < hdr.strip_cnt; s++ )
+    {
+        len += strips[s].size();
+        ends[s] = len;
+    }
+
+    a_out.resize( len );
+
+    uint8_t * out = a_out.data();
+
+    memcpy( out, &hdr, sizeof( hdr ));
+    out += sizeof( hdr );
+    memcpy( out, ends.data(), ends.size()*sizeof( uint64_t ));
+    out += ends.size()*sizeof( uint64_t );
+
+    for ( vector<uint8_t> & strip : strips )
+    {
+        memcpy( out, strip.data(), strip.size() );
+        out += strip.size();
+        vector<uint8_t>().swap( strip );
+    }
+}
+
+/**
+ * @brief Decodes an iteration buffer
+ * @param a_in - Encoded data
+ * @param a_len - Length of encoded data
+ * @param a_data - Receives iteration buffer (sized and set to width of encoded counts)
+ * @param a_th_cnt - Thread count (0 = hardware concurrency)
+ * @return True if decoded, false if encoded data is invalid (buffer is cleared)
+ */
+bool
+IterCodec::decode( const uint8_t * a_in, size_t a_len, IterBuffer & a_data, unsigned a_th_cnt )
+{
+    Header hdr;
+
+    if ( a_len < sizeof( hdr ))
+        return false;
+
+    memcpy( &hdr, a_in, sizeof( hdr ));
+
+    if ( hdr.magic != CODEC_MAGIC || !hdr.strip_rows || hdr.strip_cnt != ( hdr.height + hdr.strip_rows - 1u )/hdr.strip_rows ||
+         a_len < sizeof( hdr ) + hdr.strip_cnt*sizeof( uint64_t ))
+        return false;
+
+    vector<uint64_t> ends( hdr.strip_cnt );
+
+    memcpy( ends.data(), a_in + sizeof( hdr ), ends.size()*sizeof( uint64_t ));
+
+    uint64_t begin = sizeof( hdr ) + hdr.strip_cnt*sizeof( uint64_t );
+
+    for ( uint32_t s = 0; s < hdr.strip_cnt; s++ )
+    {
+        if ( ends[s] < ( s ? ends[s-1] : begin ) || ends[s] > a_len )
+            return false;
+    }
+
+    atomic<bool> ok( true );
+
+    a_data.assign( (size_t)hdr.width*hdr.height, hdr.wide );
+    a_data.visit( [&]( auto * a_buf )
+    {
+        parallel( hdr.strip_cnt, a_th_cnt, [&]( uint32_t a_strip )
+        {
+            uint32_t row = a_strip*hdr.strip_rows;
+            uint64_t pos = a_strip ? ends[a_strip-1] : begin;
+
+            if ( !decodeStrip( a_in + pos, ends[a_strip] - pos, a_buf + (size_t)row*hdr.width, hdr.width,
+                               min<uint32_t>( hdr.strip_rows, hdr.height - row )))
+                ok = false;
+        });
+    });
+
+    if ( !ok )
+        a_data.clear();
+
+    return ok;
+}
@@ -0,0 +1,44 @@
+#ifndef ITERCODEC_H
+#define ITERCODEC_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "iterbuffer.h"
+
+/**
+ * @brief The IterCodec class implements lossless compression of iteration buffers
+ *
+ * Iteration counts of neighboring pixels are highly correlated, thus each count is predicted
+ * from its left, upper and upper-left neighbors (median edge detector). The prediction errors
+ * (zigzag encoded) are mostly small, and are entropy coded as byte tokens by a rANS coder with
+ * a frequency table per strip. Large errors are coded as an escape token followed by raw bytes.
+ *
+ * The image is split into independent row strips (prediction does not cross strips), which
+ * are encoded and decoded in parallel. Encoded data is stored in native byte order.
+ */
+class IterCodec
+{
+public:
+    static void     encode( const IterBuffer & a_data, uint16_t a_width, std::vector<uint8_t> & a_out, unsigned a_th_cnt = 0 );
+    static bool     decode( const uint8_t * a_in, size_t a_len, IterBuffer & a_data, unsigned a_th_cnt = 0 );
+
+private:
+    /**
+     * @brief The Header struct is the header of encoded data
+     *
+     * The header is followed by the end offsets of the strips (uint64_t each), then the strips.
+     */
+    struct Header
+    {
+        uint32_t    magic;          // Data marker (also detects byte order)
+        uint16_t    width;          // Image width
+        uint16_t    height;         // Image height
+        uint16_t    strip_rows;     // Rows per strip (last strip may have less)
+        uint8_t     wide;           // Counts are 32-bit (see IterBuffer)
+        uint8_t     reserved;
+        uint32_t    strip_cnt;      // Number of strips
+    };
+};
+
+#endif // ITERCODEC_H
@@ -0,0 +1,153 @@
+#include <cstring>
+#include <QFile>
+#include <QSaveFile>
+#include "iterfile.h"
+#include "itercodec.h"
+
+using namespace std;
+
+// File marker ("MBI1") and format version
+#define ITER_FILE_MAGIC 0x3149424D
+#define ITER_FILE_VERSION 4
+
+/**
+ * @brief Writes an iteration data file
+ * @param a_fname - File name
+ * @param a_result - Calculation result
+ * @param a_ss - Supersampling factor of result
+ * @return True if written
+ *
+ * The file is replaced atomically, thus a failed save does not leave a partial file.
+ */
+bool
+IterFile::save( const QString & a_fname, const MandelbrotCalc::Result & a_result, uint8_t a_ss )
+{
+    if ( a_result.img_data.empty() || a_result.x0.size() > 0xFFFF || a_result.y0.size() > 0xFFFF )
+        return false;
+
+    vector<uint8_t> packed;
+
+    IterCodec::encode( a_result.img_data, a_result.img_width, packed );
+
+    Header hdr;
+
+    memset( &hdr, 0, sizeof( hdr ));
+    hdr.magic = ITER_FILE_MAGIC;
+    hdr.version = ITER_FILE_VERSION;
+    hdr.header_size = sizeof( Header );
+    hdr.x0_len = a_result.x0.size();
+    hdr.y0_len = a_result.y0.size();
+    hdr.x1 = a_result.x1;
+    hdr.y1 = a_result.y1;
+    hdr.x2 = a_result.x2;
+    hdr.y2 = a_result.y2;
+    hdr.iter_mx = a_result.iter_mx;
+    hdr.img_width = a_result.img_width;
+    hdr.img_height = a_result.img_height;
+    hdr.ss = a_ss;
+    hdr.data_ss = a_result.ss;
+    hdr.wide = a_result.img_data.wide();
+    hdr.simd = a_result.simd;
+    hdr.kernel = a_result.kernel;
+    hdr.th_cnt = a_result.th_cnt;
+    hdr.time_ms = a_result.time_ms;
+    hdr.interior_cnt = a_result.interior_cnt;
+    hdr.periodic_cnt = a_result.periodic_cnt;
+    hdr.sample_cnt = a_result.sample_cnt;
+    hdr.data_size = packed.size();
+
+    QSaveFile file( a_fname );
+
+    if ( !file.open( QIODevice::WriteOnly ))
+        return false;
+
+    file.write( reinterpret_cast<const char*>( &hdr ), sizeof( hdr ));
+    file.write( a_result.x0.data(), a_result.x0.size() );
+    file.write( a_result.y0.data(), a_result.y0.size() );
+    file.write( reinterpret_cast<const char*>( packed.data() ), packed.size() );
+
+    return file.commit();
+}
+
+/**
+ * @brief Reads an iteration data file if it matches the image metadata
+ * @param a_fname - File name
+ * @param a_params - Calculation parameters from metadata (bounds, origin and iteration limit)
+ * @param a_width - Image width from metadata (excludes supersampling)
+ * @param a_height - Image height from metadata (excludes supersampling)
+ * @param a_ss - Supersampling factor from metadata
+ * @param a_result - Receives calculation result (unchanged if file not read)
+ * @return True if read, false if file is missing, invalid or stale
+ */
+bool
+IterFile::load( const QString & a_fname, const MandelbrotCalc::Params & a_params, uint16_t a_width,
+                uint16_t a_height, uint8_t a_ss, MandelbrotCalc::Result & a_result )
+{
+    QFile file( a_fname );
+
+    if ( !file.open( QIODevice::ReadOnly ) || (size_t)file.size() < sizeof( Header ))
+        return false;
+
+    const uchar * map = file.map( 0, file.size() );
+    if ( !map )
+        return false;
+
+    Header      hdr;
+    uint64_t    rest = (uint64_t)file.size() - sizeof( Header );
+
+    memcpy( &hdr, map, sizeof( hdr ));
+
+    // Section sizes are checked against the size remaining after each (a sum of corrupt sizes could wrap)
+    if ( hdr.magic != ITER_FILE_MAGIC || hdr.version != ITER_FILE_VERSION || hdr.header_size != sizeof( Header ) ||
+         (uint64_t)hdr.x0_len + hdr.y0_len > rest || hdr.data_size != rest - hdr.x0_len - hdr.y0_len )
+        return false;
+
+    const char *    x0 = reinterpret_cast<const char*>( map + sizeof( Header ));
+    const char *    y0 = x0 + hdr.x0_len;
+    const uchar *   data = reinterpret_cast<const uchar*>( y0 + hdr.y0_len );
+
+    // Check for stale file (does not match metadata)
+    if ( hdr.x1 != a_params.x1 || hdr.y1 != a_params.y1 || hdr.x2 != a_params.x2 || hdr.y2 != a_params.y2 ||
+         a_params.x0.compare( 0, string::npos, x0, hdr.x0_len ) || a_params.y0.compare( 0, string::npos, y0, hdr.y0_len ) ||
+         hdr.iter_mx != a_params.iter_mx || hdr.ss != a_ss || !hdr.data_ss || hdr.data_ss > hdr.ss ||
+         hdr.img_width/hdr.data_ss != a_width || hdr.img_height/hdr.data_ss != a_height || hdr.wide != !IterBuffer::fits16( hdr.iter_mx ))
+        return false;
+
+    MandelbrotCalc::Result result;
+
+    if ( !IterCodec::decode( data, hdr.data_size, result.img_data ) ||
+         result.img_data.size() != (size_t)hdr.img_width*hdr.img_height || result.img_data.wide() != hdr.wide )
+        return false;
+
+    result.x0.assign( x0, hdr.x0_len );
+    result.y0.assign( y0, hdr.y0_len );
+    result.x1 = hdr.x1;
+    result.y1 = hdr.y1;
+    result.x2 = hdr.x2;
+    result.y2 = hdr.y2;
+    result.iter_mx = hdr.iter_mx;
+    result.th_cnt = hdr.th_cnt;
+    result.img_width = hdr.img_width;
+    result.img_height = hdr.img_height;
+    result.ss = hdr.data_ss;
+    result.time_ms = hdr.time_ms;
+    result.simd = (CpuFeatures::SimdLevel)hdr.simd;
+    result.kernel = (MandelbrotCalc::KernelType)hdr.kernel;
+    result.interior_cnt = hdr.interior_cnt;
+    result.periodic_cnt = hdr.periodic_cnt;
+    result.sample_cnt = hdr.sample_cnt;
+    result.filled_cnt = 0;
+    result.rebase_cnt = 0;
+    result.skip_iter = 0;
+    result.recheck_cnt = 0;
+    result.tile_size = 0;
+    result.reused_cnt = 0;
+    result.resumed_cnt = 0;
+    result.cache_hit_cnt = 0;
+    result.cache_miss_cnt = 0;
+    result.store_hit_cnt = 0;
+
+    a_result = move( result );
+
+    return true;
+}
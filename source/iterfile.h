@@ -0,0 +1,64 @@
+#ifndef ITERFILE_H
+#define ITERFILE_H
+
+#include <cstdint>
+#include <QString>
+#include "mandelbrotcalc.h"
+
+/**
+ * @brief The IterFile class reads and writes iteration data files
+ *
+ * An iteration data file (".mbi") is saved next to an image file and holds the calculation
+ * result of the image: a header with the result fields, followed by the iteration counts
+ * compressed by IterCodec. Loading an image with an iteration data file re-renders the counts
+ * (with any palette) instead of recalculating the image. The file is memory-mapped for loading,
+ * thus the counts are decoded (in parallel) directly from the mapped file.
+ *
+ * A file is only used if its header matches the image metadata (bounds, origin, iteration
+ * limit, size and supersampling), thus a file that is stale (e.g. metadata was edited or
+ * image was saved by another app version) is ignored. Files are written in native byte
+ * order and layout; files of other platforms are ignored as well.
+ */
+class IterFile
+{
+public:
+    static bool     save( const QString & a_fname, const MandelbrotCalc::Result & a_result, uint8_t a_ss );
+    static bool     load( const QString & a_fname, const MandelbrotCalc::Params & a_params, uint16_t a_width,
+                          uint16_t a_height, uint8_t a_ss, MandelbrotCalc::Result & a_result );
+
+private:
+    /**
+     * @brief The Header struct is the header of an iteration data file
+     *
+     * The header is followed by the origin strings (x0 then y0), then the compressed counts.
+     */
+    struct Header
+    {
+        uint32_t    magic;          // File marker (also detects byte order)
+        uint32_t    version;        // Format version
+        uint32_t    header_size;    // Header size (detects layout of other builds)
+        uint16_t    x0_len;         // Length of x0 origin string
+        uint16_t    y0_len;         // Length of y0 origin string
+        double      x1;             // x coordinate bounding point 1 (adjusted)
+        double      y1;             // y coordinate bounding point 1 (adjusted)
+        double      x2;             // x coordinate bounding point 2 (adjusted)
+        double      y2;             // y coordinate bounding point 2 (adjusted)
+        uint32_t    iter_mx;        // Max iterations
+        uint16_t    img_width;      // Image width (includes supersampling of counts)
+        uint16_t    img_height;     // Image height (includes supersampling of counts)
+        uint8_t     ss;             // Supersampling factor
+        uint8_t     wide;           // Counts are 32-bit (see IterBuffer)
+        uint8_t     simd;           // SIMD level of kernel used
+        uint8_t     kernel;         // Kernel type used
+        uint16_t    th_cnt;         // Thread count used
+        uint8_t     data_ss;        // Supersampling factor of counts (may be reduced, see MandelbrotCalc::Result)
+        uint8_t     reserved;
+        uint64_t    time_ms;        // Calc time in milliseconds
+        uint64_t    interior_cnt;   // Pixels short-circuited by cardioid/bulb check
+        uint64_t    periodic_cnt;   // Pixels stopped by periodicity detection
+        uint64_t    sample_cnt;     // Samples calculated
+        uint64_t    data_size;      // Size of compressed counts
+    };
+};
+
+#endif // ITERFILE_H
@@ -1,8 +1,43 @@
 #include "mainwindow.h"
 
+#include <iostream>
 #include <QApplication>
 #include <QStyleFactory>
 #include <QFile>
+#include <QCommandLineParser>
+#include "tilestore.h"
+
+/**
+ * @brief Compacts the persistent tile store (offline, app window is not shown)
+ * @return Exit code (0 = success)
+ *
+ * The store is opened with the configured cap, as opening evicts packs beyond it.
+ */
+static int
+compactTileStore()
+{
+    TileStore   store;
+    std::string dir = MainWindow::tileStoreDir().toStdString();
+
+    if ( !store.open( dir, (uint64_t)MainWindow::tileStoreMB() << 20 ))
+    {
+        std::cerr << "Can not open tile store: " << dir << std::endl;
+        return 1;
+    }
+
+    uint64_t size = store.size();
+
+    if ( !store.compact() )
+    {
+        std::cerr << "Tile store compaction failed: " << dir << std::endl;
+        return 1;
+    }
+
+    std::cout << "Tile store compacted: " << store.count() << " tiles, " << ( size >> 20 ) << " MB -> "
+              << ( store.size() >> 20 ) << " MB" << std::endl;
+
+    return 0;
+}
 
 /**
  * @brief Program entry point
@@ -17,6 +52,16 @@ int main(int argc, char *argv[])
 
     QApplication a(argc, argv);
 
+    QCommandLineParser parser;
+    QCommandLineOption compactOption( "compact-store", "Compact the persistent tile store and exit." );
+
+    parser.addHelpOption();
+    parser.addOption( compactOption );
+    parser.process( a );
+
+    if ( parser.isSet( compactOption ))
+        return compactTileStore();
+
     // Set application style
     a.setStyle(QStyleFactory::create("Fusion"));
 
@@ -1,4 +1,7 @@
 #include <iostream>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
 
 #include <QImage>
 #include <QPixmap>
@@ -14,13 +17,20 @@
 #include <QJsonArray>
 #include <QTimer>
 #include <QMetaObject>
+#include <QStandardPaths>
 
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include "hpreal.h"
+#include "iterfile.h"
+#include "itercodec.h"
 
 
 using namespace std;
 
+// Number of most recently used view history memos kept uncompressed
+#define MEMO_RAW_CNT 2
+
 /**
  * @brief MainWindow constructor
  * @param parent - Parent widget (null in this case)
@@ -38,6 +48,7 @@ MainWindow::MainWindow(QWidget *parent):
     m_ignore_scale_sig(false),
     m_ignore_off_sig(false),
     m_calc_history_idx(0),
+    m_memo_seq(0),
     m_app_name( QString("MandelbrotApp ") + APP_VERSION ),
     m_status_dlg( this )
 {
@@ -56,6 +67,13 @@ MainWindow::MainWindow(QWidget *parent):
     m_calc_params.x2 = 2;
     m_calc_params.y2 = 2;
 
+    // Calculated tiles are kept across sessions
+    m_calc_params.store_dir = tileStoreDir().toStdString();
+    m_calc_params.store_mb = tileStoreMB();
+
+    // Results of view history entries are kept (memoized) up to this budget
+    m_memo_budget = (size_t)m_settings.value( "history_memo_mb", 256 ).toUInt() << 20;
+
     // Adjust various UI components
     ui->menubar->hide();
     ui->lineEditResolution->setValidator( new QIntValidator( 8, 7680, this ));
@@ -184,6 +202,26 @@ MainWindow::~MainWindow()
     delete ui;
 }
 
+/**
+ * @brief Returns the directory of the persistent tile store (see TileStore)
+ * @return Directory path (in user cache location)
+ */
+QString
+MainWindow::tileStoreDir()
+{
+    return QStandardPaths::writableLocation( QStandardPaths::CacheLocation ) + "/tiles";
+}
+
+/**
+ * @brief Returns the size cap of the persistent tile store (see TileStore)
+ * @return Cap in MB (from app settings)
+ */
+uint32_t
+MainWindow::tileStoreMB()
+{
+    return QSettings( QSettings::UserScope ).value( "tile_store_mb", 2048 ).toUInt();
+}
+
 //==================== Public slots ====================
 
 /**
@@ -210,8 +248,17 @@ MainWindow::calculate()
 {
     m_calc_ss = ui->spinBoxSuperSample->value();
     m_calc_params.res = ui->lineEditResolution->text().toUShort() * m_calc_ss;
+    m_calc_params.ss = m_calc_ss;
     m_calc_params.iter_mx = ui->lineEditIterMax->text().toULong();
     m_calc_params.th_cnt = ui->spinBoxThreadCount->value();
+    m_calc_params.subdivide = ui->checkBoxSubdivide->isChecked();
+    m_calc_params.adaptive = ui->checkBoxAdaptive->isChecked();
+    m_calc_params.ss_reduce = ui->checkBoxReduce->isChecked();
+    m_calc_params.progressive = ui->checkBoxProgressive->isChecked();
+    m_calc_params.resume = ui->checkBoxResume->isChecked();
+
+    // Move origin to image center if needed to preserve precision of bounding points
+    rebaseOrigin();
 
     m_status_dlg.setProgress( 0 );
     m_status_dlg.show();
@@ -347,7 +394,8 @@ MainWindow::paletteSelect( const QString &a_text )
 /**
  * @brief Slot to receive imageSave UI signals
  *
- * Shows a save file dialog and writes image and metadata files.
+ * Shows a save file dialog and writes image and metadata files, and the iteration data
+ * file unless disabled by the "image_save_iter" setting (see IterFile).
  */
 void
 MainWindow::imageSave()
@@ -381,12 +429,20 @@ MainWindow::imageSave()
             .arg(m_calc_result.x2,0,'g',17)
             .arg(m_calc_result.y2,0,'g',17)
             .arg(m_calc_result.iter_mx)
-            .arg(m_calc_result.img_width/m_calc_ss)
-            .arg(m_calc_result.img_height/m_calc_ss)
+            .arg(m_calc_result.img_width/m_calc_result.ss)
+            .arg(m_calc_result.img_height/m_calc_result.ss)
             .arg(m_calc_result.th_cnt)
             .arg(m_calc_ss)
             .arg(m_calc_result.time_ms);
 
+        // High-precision origin (only present for deep zooms)
+        if ( m_calc_result.x0.size() || m_calc_result.y0.size() )
+        {
+            json += QString("  \"x0\":\"%1\",\n  \"y0\":\"%2\",\n")
+                .arg(QString::fromStdString(m_calc_result.x0))
+                .arg(QString::fromStdString(m_calc_result.y0));
+        }
+
         const PaletteInfo & pal_info = m_palette_edit_dlg.getPaletteInfo();
         json += QString("  \"palette\":{\n    \"name\":\"%1\",\n    \"scale\":%2,\n    \"offset\":%3,\n    \"repeat\":%4,\n    \"colors\":[")
                     .arg(QString::fromStdString(pal_info.name))
@@ -415,13 +471,25 @@ MainWindow::imageSave()
             QTextStream stream( &mdfile );
             stream << json;
         }
+
+        // Save iteration data file (".mbi" extension)
+        if ( m_settings.value( "image_save_iter", true ).toBool() )
+        {
+            fname.resize( fname.length() - 4 );
+            fname += "mbi";
+
+            if ( !IterFile::save( fname, m_calc_result, m_calc_ss ))
+                cout << "Iteration data file not saved: " << fname.toStdString() << endl;
+        }
     }
 }
 
 /**
  * @brief Slot to receive imageLoad UI signals
  *
- * Shows an open file dialog, reads metadata file, and regenerates image.
+ * Shows an open file dialog, reads metadata file, and regenerates image. The image is
+ * rendered from the iteration data file, if present and matching the metadata, instead
+ * of being recalculated.
  */
 void
 MainWindow::imageLoad()
@@ -461,6 +529,8 @@ MainWindow::imageLoad()
                     m_calc_params.y1 = jsonReadDouble( obj, "y1" );
                     m_calc_params.x2 = jsonReadDouble( obj, "x2" );
                     m_calc_params.y2 = jsonReadDouble( obj, "y2" );
+                    m_calc_params.x0 = obj.contains( "x0" ) ? jsonReadString( obj, "x0" ).toStdString() : "";
+                    m_calc_params.y0 = obj.contains( "y0" ) ? jsonReadString( obj, "y0" ).toStdString() : "";
                     m_calc_params.iter_mx = jsonReadInt( obj, "iter_mx" );
                     m_calc_result.th_cnt = jsonReadInt( obj, "th_cnt" );
                     m_calc_ss = jsonReadInt( obj, "ss" );
@@ -578,10 +648,14 @@ MainWindow::imageLoad()
                     // Ensure home button is enabled
                     ui->buttonViewTop->setDisabled( false );
 
-                    // Recalc image
-                    calculate();
+                    // Use iteration data file if present and not stale, otherwise recalc image
+                    QString iter_fname = fname.left( fname.length() - 4 ) + "mbi";
+                    bool    loaded = !m_calc.isCalculating() && IterFile::load( iter_fname, m_calc_params, w, h, m_calc_ss, m_calc_result );
 
-                    CalcPos pos = {m_calc_params.x1,m_calc_params.y1,m_calc_params.x2,m_calc_params.y2};
+                    if ( !loaded )
+                        calculate();
+
+                    CalcPos pos = {m_calc_params.x1,m_calc_params.y1,m_calc_params.x2,m_calc_params.y2,m_calc_params.x0,m_calc_params.y0};
 
                     // Loading image clears position history
                     m_calc_history.resize(0);
@@ -591,6 +665,18 @@ MainWindow::imageLoad()
                     ui->buttonViewTop->setDisabled(false);
                     ui->buttonViewNext->setDisabled(true);
                     ui->buttonViewPrev->setDisabled(false);
+
+                    if ( loaded )
+                    {
+                        m_calc_params.res = ui->lineEditResolution->text().toUShort() * m_calc_ss;
+                        m_calc_params.ss = m_calc_ss;
+                        m_calc_params.subdivide = ui->checkBoxSubdivide->isChecked();
+                        m_calc_params.adaptive = ui->checkBoxAdaptive->isChecked();
+                        m_calc_params.ss_reduce = ui->checkBoxReduce->isChecked();
+
+                        historyStore();
+                        calcCompleted();
+                    }
                 }
                 catch ( int )
                 {
@@ -616,7 +702,8 @@ MainWindow::imageLoad()
 /**
  * @brief Slot to receive viewNext UI signals
  *
- * If available, moves to next entry in view history and regenerates image.
+ * If available, moves to next entry in view history and regenerates image (or redraws
+ * memoized result).
  */
 void
 MainWindow::viewNext()
@@ -634,15 +721,19 @@ MainWindow::viewNext()
         m_calc_params.y1 = pos.y1;
         m_calc_params.x2 = pos.x2;
         m_calc_params.y2 = pos.y2;
+        m_calc_params.x0 = pos.x0;
+        m_calc_params.y0 = pos.y0;
 
-        calculate();
+        if ( !historyRecall() )
+            calculate();
     }
 }
 
 /**
  * @brief Slot to receive viewPrev UI signals
  *
- * If available, moves to previous entry in view history and regenerates image.
+ * If available, moves to previous entry in view history and regenerates image (or
+ * redraws memoized result).
  */
 void
 MainWindow::viewPrev()
@@ -661,6 +752,8 @@ MainWindow::viewPrev()
             m_calc_params.y1 = -2;
             m_calc_params.x2 = 2;
             m_calc_params.y2 = 2;
+            m_calc_params.x0.clear();
+            m_calc_params.y0.clear();
         }
         else
         {
@@ -669,16 +762,19 @@ MainWindow::viewPrev()
             m_calc_params.y1 = pos.y1;
             m_calc_params.x2 = pos.x2;
             m_calc_params.y2 = pos.y2;
+            m_calc_params.x0 = pos.x0;
+            m_calc_params.y0 = pos.y0;
         }
 
-        calculate();
+        if ( !historyRecall() )
+            calculate();
     }
 }
 
 /**
  * @brief Slot to receive viewTop UI signals
  *
- * Moves to top entry in view history and regenerates image.
+ * Moves to top entry in view history and regenerates image (or redraws memoized result).
  */
 void
 MainWindow::viewTop()
@@ -687,14 +783,17 @@ MainWindow::viewTop()
     m_calc_params.y1 = -2;
     m_calc_params.x2 = 2;
     m_calc_params.y2 = 2;
+    m_calc_params.x0.clear();
+    m_calc_params.y0.clear();
+    m_calc_history_idx = 0;
 
-    calculate();
+    if ( !historyRecall() )
+        calculate();
 
     ui->buttonViewTop->setDisabled(true);
     ui->buttonViewNext->setDisabled(m_calc_history.size() == 0);
     ui->buttonViewPrev->setDisabled(true);
     ui->buttonZoomOut->setDisabled(true);
-    m_calc_history_idx = 0;
 }
 
 /**
@@ -706,17 +805,22 @@ MainWindow::viewTop()
 void
 MainWindow::zoomIn()
 {
-    double dx = (m_calc_params.x2 - m_calc_params.x1)/4;
-    double dy = (m_calc_params.y2 - m_calc_params.y1)/4;
+    double w = m_calc_params.x2 - m_calc_params.x1;
+    double h = m_calc_params.y2 - m_calc_params.y1;
+
+    // Offset by whole new (half) pixels so that every other pixel of current image can be reused
+    double d = max( w, h )/( 2*( m_calc_params.res - 1 ));
+    double dx = round( w/( 4*d ))*d;
+    double dy = round( h/( 4*d ))*d;
 
     m_calc_params.x1 += dx;
     m_calc_params.y1 += dy;
-    m_calc_params.x2 -= dx;
-    m_calc_params.y2 -= dy;
+    m_calc_params.x2 = m_calc_params.x1 + w/2;
+    m_calc_params.y2 = m_calc_params.y1 + h/2;
 
     calculate();
 
-    CalcPos pos = {m_calc_params.x1,m_calc_params.y1,m_calc_params.x2,m_calc_params.y2};
+    CalcPos pos = {m_calc_params.x1,m_calc_params.y1,m_calc_params.x2,m_calc_params.y2,m_calc_params.x0,m_calc_params.y0};
 
     // Zooming in truncates any positions past current history index
     m_calc_history.resize(m_calc_history_idx);
@@ -739,10 +843,19 @@ MainWindow::zoomIn()
 void
 MainWindow::zoomOut()
 {
-    double dx = (m_calc_params.x2 - m_calc_params.x1)/2;
-    double dy = (m_calc_params.y2 - m_calc_params.y1)/2;
+    double w = m_calc_params.x2 - m_calc_params.x1;
+    double h = m_calc_params.y2 - m_calc_params.y1;
 
-    if ( m_calc_params.x1 - dx <= -2 || m_calc_params.y1 - dy <= -2 || m_calc_params.x2 + dx >= 2 || m_calc_params.y2 + dy >= 2 )
+    // Offset by whole current pixels so that current image can be reused at every other pixel
+    double d = max( w, h )/( m_calc_params.res - 1 );
+    double dx = round( w/( 2*d ))*d;
+    double dy = round( h/( 2*d ))*d;
+
+    // Bounds check uses absolute coordinates (bounding points are relative to origin)
+    double ox = QString::fromStdString( m_calc_params.x0 ).toDouble();
+    double oy = QString::fromStdString( m_calc_params.y0 ).toDouble();
+
+    if ( ox + m_calc_params.x1 - dx <= -2 || oy + m_calc_params.y1 - dy <= -2 || ox + m_calc_params.x1 - dx + 2*w >= 2 || oy + m_calc_params.y1 - dy + 2*h >= 2 )
     {
         m_calc_history.resize(0);
         m_calc_history_idx = 0;
@@ -754,12 +867,12 @@ MainWindow::zoomOut()
 
     m_calc_params.x1 -= dx;
     m_calc_params.y1 -= dy;
-    m_calc_params.x2 += dx;
-    m_calc_params.y2 += dy;
+    m_calc_params.x2 = m_calc_params.x1 + 2*w;
+    m_calc_params.y2 = m_calc_params.y1 + 2*h;
 
     calculate();
 
-    CalcPos pos = {m_calc_params.x1,m_calc_params.y1,m_calc_params.x2,m_calc_params.y2};
+    CalcPos pos = {m_calc_params.x1,m_calc_params.y1,m_calc_params.x2,m_calc_params.y2,m_calc_params.x0,m_calc_params.y0};
 
     // Zooming out backs-up history and truncates any positions past current history index
     m_calc_history.resize(m_calc_history_idx);
@@ -834,18 +947,11 @@ MainWindow::imageDraw()
 {
     uchar *imbuffer = imageRender();
 
-    QImage image(imbuffer, m_calc_result.img_width, m_calc_result.img_height, QImage::Format_ARGB32, [](void* a_data){
+    QImage image(imbuffer, m_calc_result.img_width / m_calc_result.ss, m_calc_result.img_height / m_calc_result.ss, QImage::Format_ARGB32, [](void* a_data){
         delete[] (uchar*)a_data;
     }, imbuffer );
 
-    if ( m_calc_ss > 1 )
-    {
-        m_viewer->setImage( image.scaled( m_calc_result.img_width / m_calc_ss, m_calc_result.img_height / m_calc_ss, Qt::KeepAspectRatio, Qt::SmoothTransformation ));
-    }
-    else
-    {
-        m_viewer->setImage( image );
-    }
+    m_viewer->setImage( image );
 }
 
 /**
@@ -853,59 +959,17 @@ MainWindow::imageDraw()
  * @return New image buffer
  *
  * The current palette, scale, and offset are used to render the image. If
- * super sampling is used, the image width and height are multiplies by
- * the super sampling factor.
+ * super sampling is used, the image is downscaled by the super sampling
+ * factor while rendering. Rendering is multi-threaded (see ImageRenderer).
  */
 uchar *
 MainWindow::imageRender()
 {
-    int imstride = m_calc_result.img_width*4;
-    uchar *imbuffer = new uchar[imstride*m_calc_result.img_height];
-    int x;
-    const uint32_t * itbuf = &m_calc_result.img_data[0];
-    uint32_t *imbuf;
+    uchar *imbuffer = new uchar[(size_t)( m_calc_result.img_width / m_calc_result.ss )*( m_calc_result.img_height / m_calc_result.ss )*4];
     const std::vector<uint32_t> & palette = m_palette_gen.renderPalette( m_palette_scale );
-    bool repeats = m_palette_gen.repeats();
-    size_t pal_size = palette.size();
-    uint32_t pal_lim = m_palette_offset + palette.size();
-    uint32_t col_first = palette[0];
-    uint32_t col_last = palette[pal_size-1];
-
-    // Must reverse y-axis due to difference in mathematical and graphical origin
-    for ( int y = m_calc_result.img_height - 1; y > -1; y-- )
-    {
-        imbuf = (uint32_t *)(imbuffer + y*imstride);
 
-        for ( x = 0; x < m_calc_result.img_width; x++, itbuf++ )
-        {
-            if ( *itbuf == 0 )
-            {
-                *imbuf++ = 0xFF000000;
-            }
-            else
-            {
-                if ( repeats )
-                {
-                    *imbuf++ = palette[(*itbuf + m_palette_offset) % pal_size];
-                }
-                else
-                {
-                    if ( *itbuf < m_palette_offset )
-                    {
-                        *imbuf++ = col_first;
-                    }
-                    else if ( *itbuf < pal_lim )
-                    {
-                        *imbuf++ = palette[*itbuf - m_palette_offset];
-                    }
-                    else
-                    {
-                        *imbuf++ = col_last;
-                    }
-                }
-            }
-        }
-    }
+    m_renderer.render( m_calc_result.img_data, m_calc_result.img_width, m_calc_result.img_height, m_calc_result.iter_mx,
+                       palette, m_palette_gen.repeats(), m_palette_offset, m_calc_result.ss, (uint32_t *)imbuffer );
 
     return imbuffer;
 }
@@ -978,15 +1042,25 @@ MainWindow::calcCompleted()
     imageDraw();
 
     // Update window title with important calc results
-    setWindowTitle( QString("%1  (%2,%3)->(%4,%5)  %6w x %7h  msec: %8")
+    // Bounding points are relative to origin (if any)
+    double ox = QString::fromStdString( m_calc_result.x0 ).toDouble();
+    double oy = QString::fromStdString( m_calc_result.y0 ).toDouble();
+
+    // Size is in pixels, interior share is of the samples calculated (as counted by the engine, which
+    // excludes reused and filled pixels, and the samples skipped by adaptive supersampling)
+    uint16_t w = m_calc_result.img_width/m_calc_result.ss;
+    uint16_t h = m_calc_result.img_height/m_calc_result.ss;
+
+    setWindowTitle( QString("%1  (%2,%3)->(%4,%5)  %6w x %7h  msec: %8  interior: %9%")
                        .arg(m_app_name)
-                       .arg(m_calc_result.x1)
-                       .arg(m_calc_result.y1)
-                       .arg(m_calc_result.x2)
-                       .arg(m_calc_result.y2)
-                       .arg(m_calc_result.img_width)
-                       .arg(m_calc_result.img_height)
+                       .arg(ox + m_calc_result.x1)
+                       .arg(oy + m_calc_result.y1)
+                       .arg(ox + m_calc_result.x2)
+                       .arg(oy + m_calc_result.y2)
+                       .arg(w)
+                       .arg(h)
                        .arg(m_calc_result.time_ms)
+                       .arg(m_calc_result.sample_cnt ? 100.0*m_calc_result.interior_cnt/m_calc_result.sample_cnt : 0.0,0,'f',1)
                    );
 
     //ui->buttonCalc->setDisabled(false);
@@ -995,6 +1069,208 @@ MainWindow::calcCompleted()
     m_status_dlg.hide();
 }
 
+/**
+ * @brief Draws a partial (progressive) calculation result
+ *
+ * Saving is disabled until the calculation completes.
+ */
+void
+MainWindow::calcPartial()
+{
+    imageDraw();
+
+    ui->buttonImageSave->setDisabled(true);
+}
+
+/**
+ * @brief Returns the memo of the current view history entry
+ * @return Memo pointer (null if none)
+ */
+shared_ptr<MainWindow::CalcMemo> &
+MainWindow::historyMemo()
+{
+    return m_calc_history_idx ? m_calc_history[m_calc_history_idx-1].memo : m_calc_top_memo;
+}
+
+/**
+ * @brief Memoizes the (completed) calculation result with the current view history entry
+ *
+ * The result is only kept if it was calculated for the position of the current entry.
+ */
+void
+MainWindow::historyStore()
+{
+    if ( !m_memo_budget )
+        return;
+
+    if ( m_calc_history_idx )
+    {
+        const CalcPos & pos = m_calc_history[m_calc_history_idx-1];
+
+        if ( pos.x1 != m_calc_params.x1 || pos.y1 != m_calc_params.y1 || pos.x2 != m_calc_params.x2 ||
+             pos.y2 != m_calc_params.y2 || pos.x0 != m_calc_params.x0 || pos.y0 != m_calc_params.y0 )
+            return;
+    }
+    else if ( m_calc_params.x1 != -2 || m_calc_params.y1 != -2 || m_calc_params.x2 != 2 || m_calc_params.y2 != 2 ||
+              m_calc_params.x0.size() || m_calc_params.y0.size() )
+    {
+        return;
+    }
+
+    shared_ptr<CalcMemo> & memo = historyMemo();
+
+    memo = make_shared<CalcMemo>();
+    memo->result = m_calc_result;
+    memo->res = m_calc_params.res;
+    memo->ss = m_calc_ss;
+    memo->subdivide = m_calc_params.subdivide;
+    memo->adaptive = m_calc_params.adaptive;
+    memo->ss_reduce = m_calc_params.ss_reduce;
+    memo->used = ++m_memo_seq;
+
+    historyTrim();
+}
+
+/**
+ * @brief Redraws the memoized result of the current view history entry, if any
+ * @return True if redrawn, false if image must be calculated
+ *
+ * The memo is only used if it was calculated with the current resolution, iteration
+ * limit, supersampling (including adaptive and reduced) and subdivision settings, and no
+ * calculation is running (which would replace the result).
+ */
+bool
+MainWindow::historyRecall()
+{
+    shared_ptr<CalcMemo> memo = historyMemo();
+    uint8_t ss = ui->spinBoxSuperSample->value();
+
+    if ( !memo || m_calc.isCalculating() || memo->ss != ss || memo->res != ui->lineEditResolution->text().toUShort()*ss ||
+         memo->result.iter_mx != ui->lineEditIterMax->text().toULong() || memo->subdivide != ui->checkBoxSubdivide->isChecked() ||
+         memo->adaptive != ui->checkBoxAdaptive->isChecked() || memo->ss_reduce != ui->checkBoxReduce->isChecked() )
+        return false;
+
+    if ( memo->packed.size() )
+    {
+        IterBuffer & buf = memo->result.img_data;
+
+        if ( !IterCodec::decode( memo->packed.data(), memo->packed.size(), buf ) ||
+             buf.size() != (size_t)memo->result.img_width*memo->result.img_height )
+        {
+            buf.clear();
+            return false;
+        }
+
+        vector<uint8_t>().swap( memo->packed );
+    }
+
+    memo->used = ++m_memo_seq;
+    historyTrim();
+
+    m_calc_result = memo->result;
+    m_calc_ss = memo->ss;
+    calcCompleted();
+
+    return true;
+}
+
+/**
+ * @brief Compresses older memos and evicts the least recently used ones over the budget
+ *
+ * The MEMO_RAW_CNT most recently used memos are kept uncompressed (for immediate redraw).
+ */
+void
+MainWindow::historyTrim()
+{
+    vector<CalcMemo*>   memos;
+    size_t              total = 0;
+
+    if ( m_calc_top_memo )
+        memos.push_back( m_calc_top_memo.get() );
+
+    for ( CalcPos & pos : m_calc_history )
+    {
+        if ( pos.memo )
+            memos.push_back( pos.memo.get() );
+    }
+
+    // Most recently used first
+    sort( memos.begin(), memos.end(), []( const CalcMemo * a, const CalcMemo * b ){ return a->used > b->used; });
+
+    for ( size_t i = 0; i < memos.size(); i++ )
+    {
+        CalcMemo * memo = memos[i];
+
+        if ( i >= MEMO_RAW_CNT && memo->packed.empty() )
+        {
+            IterCodec::encode( memo->result.img_data, memo->result.img_width, memo->packed );
+            memo->result.img_data.clear();
+        }
+
+        total += memo->packed.size() ? memo->packed.size() : memo->result.img_data.bytes();
+    }
+
+    // Evict least recently used memos
+    while ( total > m_memo_budget && memos.size() )
+    {
+        CalcMemo * memo = memos.back();
+
+        total -= memo->packed.size() ? memo->packed.size() : memo->result.img_data.bytes();
+        memos.pop_back();
+
+        if ( m_calc_top_memo.get() == memo )
+        {
+            m_calc_top_memo.reset();
+            continue;
+        }
+
+        for ( CalcPos & pos : m_calc_history )
+        {
+            if ( pos.memo.get() == memo )
+                pos.memo.reset();
+        }
+    }
+}
+
+/**
+ * @brief Moves calculation origin to image center when needed to preserve precision
+ *
+ * Bounding points are doubles relative to a high-precision origin (decimal strings).
+ * When the image width becomes small relative to the distance of the image center
+ * from the origin, the bounding points can no longer resolve individual pixels.
+ * In this case, the image center is added to the origin (using high-precision
+ * arithmetic) and the bounding points are made relative to the new origin.
+ */
+void
+MainWindow::rebaseOrigin()
+{
+    double cx = (m_calc_params.x1 + m_calc_params.x2)/2;
+    double cy = (m_calc_params.y1 + m_calc_params.y2)/2;
+    double w = max( m_calc_params.x2 - m_calc_params.x1, m_calc_params.y2 - m_calc_params.y1 );
+
+    if ( w <= 0 || max( fabs( cx ), fabs( cy )) < w*1048576 )
+        return;
+
+    // Origin precision must resolve image width plus a generous margin
+    uint16_t limbs = HPReal::limbsForBits( (int32_t)-log2( w ) + 64 );
+    uint32_t digits = (uint32_t)-log10( w ) + 20;
+
+    HPReal x0 = HPReal( cx, limbs ), y0 = HPReal( cy, limbs );
+
+    if ( m_calc_params.x0.size() )
+        x0 = x0 + HPReal( m_calc_params.x0, limbs );
+
+    if ( m_calc_params.y0.size() )
+        y0 = y0 + HPReal( m_calc_params.y0, limbs );
+
+    m_calc_params.x0 = x0.toString( digits );
+    m_calc_params.y0 = y0.toString( digits );
+    m_calc_params.x1 -= cx;
+    m_calc_params.x2 -= cx;
+    m_calc_params.y1 -= cy;
+    m_calc_params.y2 -= cy;
+}
+
 /**
  * @brief Deletes specified palette from app settings
  * @param a_palette_name - Name of palette to delete
@@ -1098,10 +1374,16 @@ MainWindow::settingsPaletteSave( PaletteInfo & a_pal_info )
 void
 MainWindow::imageRecenter( const QPointF & a_pos )
 {
-    double sx = (m_calc_params.x2-m_calc_params.x1)*m_calc_ss/m_calc_result.img_width;
-    double sy = (m_calc_params.y2-m_calc_params.y1)*m_calc_ss/m_calc_result.img_height;
-    double dx = (a_pos.x() - (m_calc_result.img_width/(2*m_calc_ss)))*sx;
-    double dy = -(a_pos.y() - (m_calc_result.img_height/(2*m_calc_ss)))*sy;
+    double sx = (m_calc_params.x2-m_calc_params.x1)*m_calc_result.ss/m_calc_result.img_width;
+    double sy = (m_calc_params.y2-m_calc_params.y1)*m_calc_result.ss/m_calc_result.img_height;
+    double dx = (a_pos.x() - (m_calc_result.img_width/(2*m_calc_result.ss)))*sx;
+    double dy = -(a_pos.y() - (m_calc_result.img_height/(2*m_calc_result.ss)))*sy;
+
+    // Shift by whole (calculated) pixels so that the overlapping image can be reused
+    double d = max( m_calc_params.x2 - m_calc_params.x1, m_calc_params.y2 - m_calc_params.y1 )/( m_calc_params.res - 1 );
+
+    dx = round( dx/d )*d;
+    dy = round( dy/d )*d;
 
     m_calc_params.x1 += dx;
     m_calc_params.x2 += dx;
@@ -1110,7 +1392,7 @@ MainWindow::imageRecenter( const QPointF & a_pos )
 
     calculate();
 
-    CalcPos pos = {m_calc_params.x1,m_calc_params.y1,m_calc_params.x2,m_calc_params.y2};
+    CalcPos pos = {m_calc_params.x1,m_calc_params.y1,m_calc_params.x2,m_calc_params.y2,m_calc_params.x0,m_calc_params.y0};
 
     // Re-centering truncates any positions past current history index
     m_calc_history.resize(m_calc_history_idx);
@@ -1130,17 +1412,17 @@ void
 MainWindow::imageZoomIn( const QRectF & a_rect )
 {
     // Calc new set coords based on new image coords (rect)
-    double sx = (m_calc_params.x2-m_calc_params.x1)*m_calc_ss/m_calc_result.img_width;
-    double sy = (m_calc_params.y2-m_calc_params.y1)*m_calc_ss/m_calc_result.img_height;
+    double sx = (m_calc_params.x2-m_calc_params.x1)*m_calc_result.ss/m_calc_result.img_width;
+    double sy = (m_calc_params.y2-m_calc_params.y1)*m_calc_result.ss/m_calc_result.img_height;
 
     m_calc_params.x1 = m_calc_params.x1 + a_rect.x()*sx;
     m_calc_params.x2 = m_calc_params.x1 + (a_rect.width()-1)*sx;
-    m_calc_params.y1 = m_calc_params.y1 + ((m_calc_result.img_height/m_calc_ss) - (a_rect.y() + a_rect.height() - 1))*sy;
+    m_calc_params.y1 = m_calc_params.y1 + ((m_calc_result.img_height/m_calc_result.ss) - (a_rect.y() + a_rect.height() - 1))*sy;
     m_calc_params.y2 = m_calc_params.y1 + (a_rect.height()-1)*sy;
 
     calculate();
 
-    CalcPos pos = {m_calc_params.x1,m_calc_params.y1,m_calc_params.x2,m_calc_params.y2};
+    CalcPos pos = {m_calc_params.x1,m_calc_params.y1,m_calc_params.x2,m_calc_params.y2,m_calc_params.x0,m_calc_params.y0};
 
     // Zooming in truncates any positions past current history index
     m_calc_history.resize(m_calc_history_idx);
@@ -1333,11 +1615,24 @@ MainWindow::cbCalcProgress( int a_progress )
 }
 
 void
-MainWindow::cbCalcCompleted( MandelbrotCalc::Result a_result )
+MainWindow::cbCalcPartial( MandelbrotCalc::Result a_result )
 {
-    m_calc_result = a_result;
+    // Result is set on GUI thread as a previous (partial) result may still be drawn (image data is moved)
+    QMetaObject::invokeMethod( this, [this,result = std::move( a_result )]() mutable {
+        m_calc_result = std::move( result );
+        calcPartial();
+    });
+}
 
-    QMetaObject::invokeMethod( this, &MainWindow::calcCompleted );
+void
+MainWindow::cbCalcCompleted( MandelbrotCalc::Result a_result )
+{
+    // Result is set on GUI thread as a previous (partial) result may still be drawn (image data is moved)
+    QMetaObject::invokeMethod( this, [this,result = std::move( a_result )]() mutable {
+        m_calc_result = std::move( result );
+        historyStore();
+        calcCompleted();
+    });
 }
 
 void
@@ -6,11 +6,13 @@
 #include <QString>
 #include <map>
 #include <vector>
+#include <memory>
 #include "MandelbrotViewer.h"
 #include "mandelbrotcalc.h"
 #include "paletteinfo.h"
 #include "paletteeditdialog.h"
 #include "calcstatusdialog.h"
+#include "imagerenderer.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -41,6 +43,10 @@ public:
     ~MainWindow();
 
     void calcCompleted();
+    void calcPartial();
+
+    static QString tileStoreDir();
+    static uint32_t tileStoreMB();
 
 public slots:
     void aspectChange( int index );
@@ -61,12 +67,18 @@ public slots:
 
 private:
     typedef std::map<std::string,PaletteInfo> PaletteMap_t;
+    struct CalcMemo;
 
     void    adjustPalette( const QString &a_text );
     void    adjustScaleSliderChanged( int a_scale );
+    void    historyStore();
+    bool    historyRecall();
+    void    historyTrim();
+    std::shared_ptr<CalcMemo> & historyMemo();
     void    imageDraw();
     uchar * imageRender();
     QString inputPaletteName( const QString & a_title );
+    void    rebaseOrigin();
     void    runCalculate();
     void    settingsPaletteDelete( const std::string & palette_name );
     void    settingsPaletteLoadAll();
@@ -85,6 +97,7 @@ private:
 
     // MandelbrotCalc::IObserver methods
     void    cbCalcProgress( int a_progress );
+    void    cbCalcPartial( MandelbrotCalc::Result a_result );
     void    cbCalcCompleted( MandelbrotCalc::Result a_result );
     void    cbCalcCancelled();
 
@@ -108,17 +121,38 @@ private:
         uint8_t         minor;  // Minor axis (i.e. 9)
     };
 
+    /**
+     * @brief The CalcMemo struct holds the calculation result of a view history entry
+     *
+     * Memos other than the most recently used are compressed (see historyTrim).
+     */
+    struct CalcMemo
+    {
+        MandelbrotCalc::Result  result;     // Result (image data empty if compressed)
+        std::vector<uint8_t>    packed;     // Compressed image data (empty if not compressed, see IterCodec)
+        uint16_t                res;        // Calculated resolution (includes supersampling)
+        uint8_t                 ss;         // Supersampling factor
+        bool                    subdivide;  // Subdivision option
+        bool                    adaptive;   // Adaptive supersampling option
+        bool                    ss_reduce;  // Reduced (banded) supersampling option
+        uint64_t                used;       // Last use (sequence number)
+    };
+
     struct CalcPos
     {
         double      x1;
         double      y1;
         double      x2;
         double      y2;
+        std::string x0;
+        std::string y0;
+        std::shared_ptr<CalcMemo> memo;     // Memoized result (null if none)
     };
 
     Ui::MainWindow *            ui;
     QSettings                   m_settings;
     MandelbrotCalc              m_calc;
+    ImageRenderer               m_renderer;
     MandelbrotViewer *          m_viewer;
     PaletteEditDialog           m_palette_edit_dlg;
     bool                        m_palette_dlg_edit_init;
@@ -137,6 +171,9 @@ private:
     std::vector<AspectRatio>    m_aspect_ratios;
     std::vector<CalcPos>        m_calc_history;
     uint32_t                    m_calc_history_idx;
+    std::shared_ptr<CalcMemo>   m_calc_top_memo;    // Memoized result of top view (not in history)
+    uint64_t                    m_memo_seq;         // Memo use sequence number
+    size_t                      m_memo_budget;      // Max memory used by memos (0 = disabled)
     QString                     m_cur_dir;
     QString                     m_app_name;
     CalcStatusDialog            m_status_dlg;
@@ -4,11 +4,136 @@
 #include <algorithm>
 #include <cmath>
 #include "mandelbrotcalc.h"
+#include "hpreal.h"
 
 using namespace std;
 
 typedef std::chrono::high_resolution_clock Clock;
 
+// Periodicity detection tolerance as a fraction of pixel spacing
+#define PER_TOL_SCALE 1e-4
+
+// Initial tile size for subdivision mode
+#define MS_TILE_SIZE 128
+
+// Tiles with a dimension at or below this size are calculated without subdivision
+#define MS_TILE_MIN 6
+
+// Automatic work tile size limits, and target number of work tiles per thread
+#define TILE_SIZE_MIN 16
+#define TILE_SIZE_MAX 64
+#define TILE_PER_THREAD 64
+
+// Iteration limit used to estimate work tile cost
+#define TILE_PROBE_ITER 256
+
+// Pixel spacing of first pass in progressive mode (power of 2)
+#define PROG_STEP 16
+
+// Max misalignment (in pixels) of a new image with the previous image for pixels to be reused
+#define REUSE_TOL 1e-3
+
+// Max ratio of pixel spacing between a new image and the previous image for pixels to be reused
+#define REUSE_MAX_SCALE 16
+
+// Tile cache lattice quantization: sub-pixel offset steps per pixel, and spacing steps per octave
+#define CACHE_PHASE 1024
+#define CACHE_SPACING 4294967296.0
+
+// Single precision is not used when pixel spacing falls below this fraction of coordinate magnitude
+// (nearly all pixels would then need to be recalculated in double precision)
+#define FLOAT_SCALE 1e-5
+
+// Single precision is selected automatically when pixel spacing is at or above this fraction of coordinate
+// magnitude (below it, the share of pixels recalculated in double precision makes float slower than double)
+#define FLOAT_AUTO_SCALE 1e-4
+
+// Single precision is selected automatically up to this iteration limit (pixels reaching the limit, and
+// periodic pixels, are recalculated in double precision, thus float is slower with higher limits)
+#define FLOAT_AUTO_MAX_ITER 256
+
+// An automatically selected float kernel is replaced by the double kernel while the pixels recalculated in
+// double precision exceed this share of the samples calculated (see tileKernel)
+#define FLOAT_AUTO_RECHECK 0.03
+
+// Single precision is not used at or above this iteration limit (larger counts can't be held in a float)
+#define FLOAT_MAX_ITER 0x1000000
+
+// Double precision is not used when pixel spacing falls below this fraction of coordinate magnitude
+#define PERTURB_SCALE 1e-12
+
+// Double-double precision limit (pixel spacing as a fraction of coordinate magnitude)
+#define DD_SCALE 1e-20
+
+// Max image size (pixels) for which double-double is selected instead of perturbation. Measured
+// costs are ~25 ns per pixel iteration for double-double versus ~5 ns for perturbation plus ~500 ns
+// per reference orbit iteration, thus double-double is only cheaper for very small images.
+#define DD_MAX_PIXELS 16
+
+// Extra fraction bits (beyond pixel spacing) used for the reference orbit
+#define PERTURB_EXTRA_BITS 64
+
+// Samples per axis kept for each pixel of a supersampled image with reduced supersampling; larger
+// supersampling factors are calculated in bands and reduced to this (see reduceBand)
+#define SS_KEEP 2
+
+// Max samples per band of a supersampled calculation (two band buffers are used, see nextBand)
+#define SS_BAND_SAMPLES 0x100000
+
+// Adaptive supersampling: max count difference between neighboring pixels that is not detail, and
+// jitter range of sample columns and lines (fraction of sample spacing, 1 = anywhere within stratum)
+#define SS_DETAIL_TOL 0
+#define SS_JITTER 1.0
+
+/**
+ * @brief Converts a decimal string to double-double
+ * @param a_value - Decimal value (empty = 0)
+ * @return Double-double value
+ */
+static DoubleDouble
+toDoubleDouble( const string & a_value )
+{
+    if ( a_value.empty() )
+        return DoubleDouble();
+
+    // Four fraction limbs (128 bits) exceed double-double precision for |value| < 2
+    HPReal  val( a_value, 4 );
+    double  hi = val.toDouble();
+
+    return DoubleDouble( hi, ( val - HPReal( hi, 4 )).toDouble() );
+}
+
+/**
+ * @brief Integer division rounding toward negative infinity
+ * @param a_num - Numerator
+ * @param a_den - Denominator (positive)
+ * @return Quotient
+ */
+static inline int64_t
+floorDiv( int64_t a_num, int64_t a_den )
+{
+    return a_num >= 0 ? a_num/a_den : -(( -a_num + a_den - 1 )/a_den );
+}
+
+/**
+ * @brief Returns the jitter of a sample column or line (adaptive supersampling)
+ * @param a_idx - Column index, or line index offset by column count
+ * @return Offset in sample spacings (within +/- SS_JITTER/2)
+ *
+ * The offset is a hash of the index (splitmix64), thus images are reproducible.
+ */
+static inline double
+jitter( uint64_t a_idx )
+{
+    uint64_t    z = a_idx + 0x9E3779B97F4A7C15ull;
+
+    z = ( z ^ ( z >> 30 ))*0xBF58476D1CE4E5B9ull;
+    z = ( z ^ ( z >> 27 ))*0x94D049BB133111EBull;
+    z ^= z >> 31;
+
+    return ( ldexp( (double)( z >> 11 ), -53 ) - 0.5 )*SS_JITTER;
+}
+
 /**
  * @brief MandelbrotCalc constructor
  * @param a_use_thread_pool - If true, requests worker thread pool be maintained across calculations
@@ -18,10 +143,18 @@ MandelbrotCalc::MandelbrotCalc( bool a_use_thread_pool, uint8_t a_initial_pool_s
     m_observer(0),
     m_use_thread_pool( a_use_thread_pool ),
     m_worker_count(0),
+    m_grid_gen(0),
+    m_simd_level( CpuFeatures::simdLevel() ),
+    m_keep_orbit(false),
+    m_prev_kept(false),
+    m_resume_iter(0),
     m_exit(false)
 {
-    // Indicate no work to do by setting negative current image line (Y-axis)
-    atomic_store( &m_y_cur, -1 );
+    // Indicate no work to do by setting negative current work tile
+    atomic_store( &m_grid_pending, 0 );
+    atomic_store( &m_grid_active, 0 );
+    atomic_store( &m_tiles_pending, 0 );
+    atomic_store( &m_ctrl_waiting, false );
 
     // Create initial thread pool if requested
     if ( m_use_thread_pool )
@@ -86,11 +219,22 @@ MandelbrotCalc::calculate( IObserver & a_observer, Params & a_params )
         throw out_of_range("Invalid max iterations parameter: must be greater than zero.");
     }
 
+    // Origin strings must be valid decimal numbers (throws invalid_argument)
+    if ( a_params.x0.size() )
+        HPReal( a_params.x0, 2 );
+
+    if ( a_params.y0.size() )
+        HPReal( a_params.y0, 2 );
+
     // Control thread holds this mutex for duration of calculation
     lock_guard lock( m_control_mutex );
 
     m_params = a_params;
     m_observer = &a_observer;
+
+    // A stop request received after the previous calculation completed does not apply
+    m_cancel = false;
+
     m_control_cvar.notify_one();
 }
 
@@ -104,12 +248,13 @@ MandelbrotCalc::controlThread()
         ctrl_lock.lock();
         m_cancel = false;
 
+        // Note: exit must be checked before waiting as it may be set while a calculation is finishing
         while( m_observer == 0 )
         {
-            m_control_cvar.wait(ctrl_lock);
             if ( m_exit )
                 return;
 
+            m_control_cvar.wait(ctrl_lock);
         }
 
         // Start timer
@@ -117,6 +262,8 @@ MandelbrotCalc::controlThread()
 
         Result result;
 
+        result.x0 = m_params.x0;
+        result.y0 = m_params.y0;
         result.x1 = m_params.x1;
         result.y1 = m_params.y1;
         result.x2 = m_params.x2;
@@ -152,7 +299,67 @@ MandelbrotCalc::controlThread()
             result.img_height = m_params.res;
         }
 
-        unique_lock lock( m_worker_mutex );
+        // Origin (if any) as double, only used for double kernel and kernel selection
+        double ox = result.x0.size() ? HPReal( result.x0, 2 ).toDouble() : 0;
+        double oy = result.y0.size() ? HPReal( result.y0, 2 ).toDouble() : 0;
+        double cmax = max( fabs( ox ), fabs( oy )) + max( max( fabs( result.x1 ), fabs( result.x2 )), max( fabs( result.y1 ), fabs( result.y2 )));
+
+        // Select float kernels for shallow views, and higher precision kernels when pixel spacing approaches
+        // double precision of coordinates
+        result.kernel = m_params.kernel;
+        bool float_auto = false;
+        if ( result.kernel == KT_AUTO )
+        {
+            if ( m_delta >= cmax*FLOAT_AUTO_SCALE && m_params.iter_mx <= FLOAT_AUTO_MAX_ITER )
+            {
+                result.kernel = KT_FLOAT;
+                float_auto = true;
+            }
+            else if ( m_delta >= cmax*PERTURB_SCALE )
+                result.kernel = KT_DOUBLE;
+            else if ( m_delta >= cmax*DD_SCALE && (uint32_t)result.img_width*result.img_height <= DD_MAX_PIXELS )
+                result.kernel = KT_DOUBLE_DOUBLE;
+            else
+                result.kernel = KT_PERTURB;
+        }
+
+        // Float kernels are vectorized only, and have limited coordinate precision and iteration range
+        if ( result.kernel == KT_FLOAT && ( !m_params.simd || m_simd_level == CpuFeatures::SIMD_NONE ||
+             m_delta < cmax*FLOAT_SCALE || m_params.iter_mx >= FLOAT_MAX_ITER ))
+            result.kernel = KT_DOUBLE;
+
+        // Adaptive supersampling calculates the samples of pixels with detail only (see markDetail), thus
+        // does not use subdivision (which skips the samples of uniform regions)
+        m_adaptive = m_params.adaptive && m_params.ss > 1;
+        m_adapt_band = false;
+        if ( m_adaptive )
+        {
+            m_params.subdivide = false;
+        }
+
+        // Reduced supersampling beyond SS_KEEP (or adaptive) is calculated in bands, and the samples of each
+        // pixel are reduced or copied (reuse, resume, tile cache and progressive passes need the image of all
+        // samples, thus are not used)
+        bool stream = ( m_params.ss_reduce && m_params.ss > SS_KEEP ) || m_adaptive;
+        m_keep = m_params.ss_reduce && m_params.ss > SS_KEEP ? SS_KEEP : max<uint8_t>( m_params.ss, 1 );
+        result.ss = m_keep;
+
+        // Previous result of same view is continued (higher iteration limit) or derived from (lower)
+        bool resume = !stream && checkResume( result );
+
+        if ( resume && result.iter_mx < m_prev.iter_mx )
+        {
+            deriveImage( result );
+
+            result.time_ms = chrono::duration_cast<std::chrono::milliseconds>( Clock::now() - t1 ).count();
+            m_observer->cbCalcCompleted( std::move( result ));
+            m_observer = 0;
+            ctrl_lock.unlock();
+            continue;
+        }
+
+        // Pixels of previous result are reused if they coincide with pixels of image (pan or zoom)
+        bool reuse = !resume && !stream && checkReuse( result );
 
         // Prepare internal parameters
         m_x1 = result.x1;
@@ -161,22 +368,313 @@ MandelbrotCalc::controlThread()
         m_w = result.img_width;
         m_h = result.img_height;
 
-        // Resize image data buffer
-        result.img_data.resize( result.img_width  * result.img_height );
-        // m_data points to beginning of data buffer
-        m_data = &result.img_data[0];
+        m_cx.resize( m_w );
+        m_cy.resize( m_h );
+
+        m_sa_iter = 0;
+
+        if ( result.kernel == KT_PERTURB )
+        {
+            // Reference orbit is at center pixel, coordinate tables hold offsets from reference
+            uint16_t rx = m_w/2, ry = m_h/2;
+
+            for ( uint16_t x = 0; x < m_w; x++ )
+            {
+                m_cx[x] = ((int32_t)x - rx)*m_delta;
+            }
+
+            for ( uint16_t y = 0; y < m_h; y++ )
+            {
+                m_cy[y] = ((int32_t)y - ry)*m_delta;
+            }
+
+            // Reference orbit may take some time, release control lock so calculation can be cancelled
+            ctrl_lock.unlock();
+            bool ok = calcReferenceOrbit( result, rx, ry );
+            ctrl_lock.lock();
+
+            if ( !ok || m_cancel )
+            {
+                m_observer->cbCalcCancelled();
+                m_observer = 0;
+                ctrl_lock.unlock();
+                continue;
+            }
+
+            if ( m_params.series )
+            {
+                calcSeriesApprox();
+            }
+        }
+        else if ( result.kernel == KT_DOUBLE_DOUBLE )
+        {
+            // Precompute pixel coordinates in double-double (origin + bounding point + offset)
+            DoubleDouble ox_dd = toDoubleDouble( result.x0 ), oy_dd = toDoubleDouble( result.y0 );
+
+            m_cx_dd.resize( m_w );
+            for ( uint16_t x = 0; x < m_w; x++ )
+            {
+                m_cx_dd[x] = ox_dd + ( DoubleDouble( m_x1 ) + DoubleDouble( m_delta )*x );
+            }
+
+            m_cy_dd.resize( m_h );
+            for ( uint16_t y = 0; y < m_h; y++ )
+            {
+                m_cy_dd[y] = oy_dd + ( DoubleDouble( m_y1 ) + DoubleDouble( m_delta )*y );
+            }
+        }
+        else
+        {
+            // Precompute pixel coordinates (x accumulates delta, y is multiplied)
+            double xr = m_x1;
+            for ( uint16_t x = 0; x < m_w; x++, xr += m_delta )
+            {
+                m_cx[x] = ox + xr;
+            }
+
+            for ( uint16_t y = 0; y < m_h; y++ )
+            {
+                m_cy[y] = oy + ( m_y1 + y*m_delta );
+            }
+
+            if ( reuse )
+            {
+                // Reused pixels keep their exact coordinates
+                for ( uint16_t x = 0; x < m_w; x++ )
+                {
+                    if ( m_reuse_x[x] >= 0 )
+                        m_cx[x] = m_prev_cx[m_reuse_x[x]];
+                }
+
+                for ( uint16_t y = 0; y < m_h; y++ )
+                {
+                    if ( m_reuse_y[y] >= 0 )
+                        m_cy[y] = m_prev_cy[m_reuse_y[y]];
+                }
+            }
+            else if ( resume )
+            {
+                // Continued orbits keep their exact coordinates (which may have been reused)
+                m_cx = m_prev_cx;
+                m_cy = m_prev_cy;
+            }
+        }
+
+        if ( result.kernel == KT_FLOAT )
+        {
+            m_cx_f.assign( m_cx.begin(), m_cx.end() );
+            m_cy_f.assign( m_cy.begin(), m_cy.end() );
+        }
+
+        unique_lock lock( m_worker_mutex );
+
+        // Periodicity tolerance must be well below pixel spacing to avoid stopping slowly escaping orbits
+        m_per_tol = m_params.periodicity ? PER_TOL_SCALE*m_delta : 0;
+
+        // Select kernel based on kernel type and CPU support
+        // Note: continued pixels did not escape, thus would all be rechecked by a float kernel
+        result.simd = m_params.simd && ( result.kernel == KT_DOUBLE || result.kernel == KT_FLOAT ) ? m_simd_level : CpuFeatures::SIMD_NONE;
+        m_float_fallback = nullptr;
+        if ( result.kernel == KT_PERTURB )
+        {
+            m_kernel = &MandelbrotCalc::kernelPerturb;
+        }
+        else if ( result.kernel == KT_DOUBLE_DOUBLE )
+        {
+            m_kernel = &MandelbrotCalc::kernelDoubleDouble;
+        }
+        else
+        {
+            switch ( result.simd )
+            {
+#ifdef CPU_X86
+            case CpuFeatures::SIMD_AVX512:
+                m_kernel = result.kernel == KT_FLOAT && !resume ? &MandelbrotCalc::kernelFloatAVX512 : &MandelbrotCalc::kernelAVX512;
+                if ( float_auto )
+                    m_float_fallback = &MandelbrotCalc::kernelAVX512;
+                break;
+            case CpuFeatures::SIMD_AVX2:
+                m_kernel = result.kernel == KT_FLOAT && !resume ? &MandelbrotCalc::kernelFloatAVX2 : &MandelbrotCalc::kernelAVX2;
+                if ( float_auto )
+                    m_float_fallback = &MandelbrotCalc::kernelAVX2;
+                break;
+#endif
+            default:
+                m_kernel = &MandelbrotCalc::kernelScalar;
+                break;
+            }
+        }
+
+        // Image data of bands holds the kept samples of each pixel (image size is then m_keep per pixel,
+        // see reduceBand), samples are calculated into band buffers
+        m_ss = stream ? m_params.ss : 1;
+        m_ss_w = result.img_width/m_ss;
+        m_ss_h = result.img_height/m_ss;
+        if ( stream )
+        {
+            result.img_width = m_ss_w*m_keep;
+            result.img_height = m_ss_h*m_keep;
+        }
+
+        // Size image data buffer (16-bit counts if iteration limit allows)
+        result.img_data.assign( (size_t)result.img_width*result.img_height, !IterBuffer::fits16( result.iter_mx ));
+        m_data = stream ? &m_band_data : &result.img_data;
+
+        // Orbits of pixels that may still escape are kept if requested, only these are continued when
+        // resuming. Reused pixels need the orbits of the previous result.
+        m_resume_iter = 0;
+        vector<KeptOrbit>().swap( m_orbits );
+        if ( resume )
+        {
+            m_resume_orbit.swap( m_prev_orbit );
+            m_resume_iter = m_prev.iter_mx;
+        }
+        m_keep_orbit = resume || ( m_params.resume && !m_params.subdivide && !stream &&
+                       ( result.kernel == KT_DOUBLE || result.kernel == KT_FLOAT ) && ( !reuse || m_prev_kept ));
+
+        // Regions of image to calculate (all of image, or the parts not covered by previous image)
+        vector<Tile> rects;
+        m_skip = 0;
+        result.resumed_cnt = 0;
+        if ( reuse )
+        {
+            result.reused_cnt = reuseRegions( rects );
+        }
+        else if ( resume )
+        {
+            // Escaped pixels are copied, the others are continued (see calcTile)
+            m_prev.img_data.visit( [&]( const auto * a_src )
+            {
+                result.img_data.visit( [&]( auto * a_dst )
+                {
+                    copy( a_src, a_src + m_prev.img_data.size(), a_dst );
+                });
+            });
+            for ( size_t i = 0; i < result.img_data.size(); i++ )
+            {
+                if ( resumable( i ))
+                    result.resumed_cnt++;
+            }
+
+            result.reused_cnt = result.img_data.size() - result.resumed_cnt;
+            rects.push_back({ 0, 0, m_w, m_h });
+        }
+        else
+        {
+            result.reused_cnt = 0;
+            rects.push_back({ 0, 0, m_w, m_h });
+        }
+
+        // Fill parts of regions to calculate from tile cache (continued pixels are not cached)
+        bool cache = m_params.cache_mb && !m_params.subdivide && !stream && ( result.kernel == KT_DOUBLE || result.kernel == KT_FLOAT );
+        m_cache.setBudget( (size_t)m_params.cache_mb << 20 );
+        result.cache_hit_cnt = 0;
+        result.cache_miss_cnt = 0;
+        result.store_hit_cnt = 0;
+        if ( cache )
+        {
+            // Store is (re)opened when its directory changes; it is left closed if it can't be opened
+            if ( m_params.store_dir != m_store.dir() )
+            {
+                if ( m_params.store_dir.size() )
+                    m_store.open( m_params.store_dir, (uint64_t)m_params.store_mb << 20 );
+                else
+                    m_store.close();
+            }
+            m_store.setCap( (uint64_t)m_params.store_mb << 20 );
+
+            cacheLattice( result, ox, oy );
+
+            if ( !resume )
+            {
+                result.reused_cnt += cacheFill( rects, result );
+            }
+        }
 
         // Note: most threads will be waiting on their cvar, but new threads may not make it to
         // the cvar before the "start work" notify is signalled, thus new workers will check if
         // there is work to do BEFORE waiting on initial notify. This avoids the race condition
         // that could cause them to become stuck on the wait after the signal is sent. Thus the
-        // work (m_y_cur) must be set before any workers are signalled.
+        // work (m_grid_gen) must be set before any workers are signalled.
+
+        atomic_store( &m_interior_cnt, (uint64_t)0 );
+        atomic_store( &m_periodic_cnt, (uint64_t)0 );
+        atomic_store( &m_filled_cnt, (uint64_t)0 );
+        atomic_store( &m_rebase_cnt, (uint64_t)0 );
+        atomic_store( &m_recheck_cnt, (uint64_t)0 );
+        atomic_store( &m_sample_cnt, (uint64_t)0 );
+        atomic_store( &m_px_done, (uint64_t)0 );
+        atomic_store( &m_prog, 0 );
+
+        // Progressive passes halve pixel spacing down to 1 (not supported by subdivision, reuse, resume,
+        // cached tiles, or bands, as passes fill the whole image)
+        m_pass_step = m_params.progressive && !m_params.subdivide && !reuse && !resume && !result.cache_hit_cnt && !stream ? PROG_STEP : 1;
+
+        if ( stream )
+        {
+            // Coordinate tables of whole image are kept, those of each band are copied from them
+            m_px_total = (uint64_t)m_ss_w*m_ss_h*m_ss*m_ss;
+            m_ss_cx.swap( m_cx );
+            m_ss_cy.swap( m_cy );
+            m_ss_cx_f.swap( m_cx_f );
+            m_ss_cy_f.swap( m_cy_f );
+            m_ss_cx_dd.swap( m_cx_dd );
+            m_ss_cy_dd.swap( m_cy_dd );
+
+            // Sample columns and lines are jittered (adaptive), except the base sample of each pixel
+            m_jit_x.assign( m_ss_cx.size(), 0 );
+            m_jit_y.assign( m_ss_cy.size(), 0 );
+            if ( m_adaptive )
+            {
+                for ( size_t i = 0; i < m_jit_x.size(); i++ )
+                {
+                    if ( i % m_ss != m_ss/2u )
+                        m_jit_x[i] = jitter( i )*m_delta;
+                }
+
+                for ( size_t i = 0; i < m_jit_y.size(); i++ )
+                {
+                    if ( i % m_ss != m_ss/2u )
+                        m_jit_y[i] = jitter( i + m_jit_x.size() )*m_delta;
+                }
+            }
+
+            m_band = { 0, 0, 0, 0 };
+            if ( m_adaptive )
+            {
+                // Base pass calculates the base sample of each pixel (bands follow, see markDetail)
+                m_w = m_ss_w;
+                m_h = m_ss_h;
+                setSampleCoords( result.kernel, m_ss/2, m_ss/2, m_ss );
+                m_base.assign( (size_t)m_w*m_h, result.img_data.wide() );
+                m_data = &m_base;
+                queueWork( result, { Tile{ 0, 0, m_w, m_h }}, (uint64_t)m_w*m_h );
+            }
+            else if ( !nextBand( result ))
+            {
+                // Image has no pixels (e.g. minor axis is less than one pixel)
+                m_grid.clear();
+                m_tiles.clear();
+                atomic_store( &m_tiles_pending, 0 );
+                result.tile_size = 0;
+            }
+        }
+        else
+        {
+            m_px_total = (uint64_t)m_w*m_h - result.reused_cnt;
+            queueWork( result, rects, m_px_total );
+        }
 
-        // Set work done and remaining (first line to process)
-        atomic_store( &m_y_done, result.img_height );
-        atomic_store( &m_y_cur, result.img_height - 1 );
+        // Copy reused pixels (after tile cost probes, which may write to them)
+        if ( reuse )
+        {
+            reuseImage();
+        }
 
-        m_y_upd = 0.99*m_h;
+        // Previous image is not valid beyond this point (coordinates tables changed)
+        m_prev.img_data.clear();
+        vector<KeptOrbit>().swap( m_prev_orbit );
+        m_prev_kept = false;
 
         // Adjust worker threads if needed
         if( m_params.th_cnt > m_workers.size() )
@@ -211,15 +709,110 @@ MandelbrotCalc::controlThread()
             m_workers.resize(m_worker_count);
         }
 
-        // Start workers
-        m_worker_cvar.notify_all();
-        lock.unlock();
+        Tile    done_band;          // Band to reduce while next band is calculated (empty if none)
 
-        // Wait for all work to be completed
-        // Note that for small/simple images, some workers may not contribute to the calculation
-        while( atomic_load( &m_y_done ) > 0 && !m_cancel )
+        done_band.w = 0;
+
+        while ( 1 )
         {
-            m_control_cvar.wait( ctrl_lock );
+            if ( !m_params.subdivide )
+            {
+                // Workers that were late to a previous calculation (or pass) may still be checking queues
+                while ( atomic_load( &m_grid_active ) > 0 )
+                {
+                    this_thread::yield();
+                }
+
+                atomic_store( &m_grid_pending, (int32_t)m_grid.size() );
+                dealGrid( m_worker_count );
+                m_grid_gen++;
+            }
+
+            // Start workers
+            m_worker_cvar.notify_all();
+            lock.unlock();
+
+            // Samples of previous band are reduced while workers calculate the current band
+            if ( done_band.w )
+            {
+                reduceBand( result, done_band );
+                done_band.w = 0;
+            }
+
+            // Wait for all work to be completed
+            // Note that for small/simple images, some workers may not contribute to the calculation
+            atomic_store( &m_ctrl_waiting, true );
+            while(( atomic_load( &m_grid_pending ) > 0 || atomic_load( &m_tiles_pending ) > 0 ) && !m_cancel )
+            {
+                m_control_cvar.wait( ctrl_lock );
+            }
+            atomic_store( &m_ctrl_waiting, false );
+
+            if ( m_cancel )
+            {
+                break;
+            }
+
+            if ( !m_params.subdivide )
+            {
+                // Accumulate worker counters over passes
+                result.th_exec.resize( m_queues.size() );
+                result.th_stolen.resize( m_queues.size() );
+                for ( size_t i = 0; i < m_queues.size(); i++ )
+                {
+                    result.th_exec[i] += m_queues[i].executed;
+                    result.th_stolen[i] += m_queues[i].stolen;
+                }
+            }
+
+            if ( stream )
+            {
+                // Pixels with detail are marked once base samples are calculated (adaptive)
+                if ( m_adaptive && !m_adapt_band )
+                {
+                    m_px_total = (uint64_t)m_ss_w*m_ss_h + markDetail()*( (uint64_t)m_ss*m_ss - 1 );
+                    m_data = &m_band_data;
+                }
+
+                // Completed band is kept in the other band buffer, last band is reduced now
+                m_band_data.swap( m_band_done );
+                done_band = m_band;
+
+                lock.lock();
+                if ( nextBand( result ))
+                {
+                    continue;
+                }
+                lock.unlock();
+
+                reduceBand( result, done_band );
+                break;
+            }
+
+            if ( m_pass_step == 1 )
+            {
+                break;
+            }
+
+            // Partial result holds an image filled from pass pixels, which is handed to the observer (moved,
+            // not copied). The result is copied without its image data, which is still being calculated.
+            {
+                IterBuffer  work;
+
+                work.swap( result.img_data );
+                Result partial( result );
+                result.img_data.swap( work );
+
+                fillPass( partial.img_data );
+                partial.time_ms = chrono::duration_cast<std::chrono::milliseconds>( Clock::now() - t1 ).count();
+                m_observer->cbCalcPartial( std::move( partial ));
+            }
+
+            // Next pass calculates the remaining pixels of a lattice with half the spacing
+            lock.lock();
+            m_skip = m_pass_step;
+            m_skip_rect = { 0, 0, m_w, m_h };
+            m_pass_step /= 2;
         }
 
         // Stop timer
@@ -235,10 +828,50 @@ MandelbrotCalc::controlThread()
         else
         {
             //result.img_data = m_data;
+            result.interior_cnt = atomic_load( &m_interior_cnt );
+            result.periodic_cnt = atomic_load( &m_periodic_cnt );
+            result.filled_cnt = atomic_load( &m_filled_cnt );
+            result.rebase_cnt = atomic_load( &m_rebase_cnt );
+            result.skip_iter = m_sa_iter;
+            result.recheck_cnt = atomic_load( &m_recheck_cnt );
+            result.sample_cnt = atomic_load( &m_sample_cnt );
+
+            // Keep image for reuse by next calculation (see checkReuse), kept orbits are sorted for lookup
+            if ( !m_params.subdivide && !stream && ( result.kernel == KT_DOUBLE || result.kernel == KT_FLOAT ))
+            {
+                m_prev = result;
+                m_prev_periodicity = m_params.periodicity;
+                m_prev_delta = m_delta;
+                m_prev_cx = m_cx;
+                m_prev_cy = m_cy;
+                sort( m_orbits.begin(), m_orbits.end(), []( const KeptOrbit & a, const KeptOrbit & b ){ return a.idx < b.idx; });
+                m_prev_orbit.swap( m_orbits );
+                m_prev_kept = m_keep_orbit;
+            }
+
+            if ( cache )
+            {
+                cacheStore();
+            }
+
             result.time_ms = chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count(); // time msec;
 
-            // Notify observer of completion
-            m_observer->cbCalcCompleted( result );
+            // Notify observer of completion (result is not used after)
+            m_observer->cbCalcCompleted( std::move( result ));
+        }
+
+        // Orbits are only kept for the previous result
+        m_keep_orbit = false;
+        vector<KeptOrbit>().swap( m_orbits );
+        vector<KeptOrbit>().swap( m_resume_orbit );
+
+        // Band buffers are not kept (workers are stopped or idle)
+        if ( stream )
+        {
+            m_band_data.clear();
+            m_band_done.clear();
+            m_base.clear();
+            vector<uint8_t>().swap( m_detail );
         }
 
         // Clear observer and release ctrl lock
@@ -255,7 +888,7 @@ MandelbrotCalc::controlThread()
 bool
 MandelbrotCalc::isCalculating()
 {
-    return atomic_load( &m_y_cur ) >= 0;
+    return atomic_load( &m_grid_pending ) > 0 || atomic_load( &m_tiles_pending ) > 0;
 }
 
 
@@ -282,9 +915,6 @@ MandelbrotCalc::stopWorkerThreads()
     {
         unique_lock lock(m_worker_mutex);
 
-        // Set no work indicated
-        atomic_store( &m_y_cur, -1 );
-
         // Signal waiting workers to exit
         m_worker_count = 0;
         m_worker_cvar.notify_all();
@@ -299,6 +929,11 @@ MandelbrotCalc::stopWorkerThreads()
 
         m_workers.resize(0);
     }
+
+    // Discard any remaining tiles (i.e. cancelled calculation)
+    m_tiles.clear();
+    atomic_store( &m_tiles_pending, 0 );
+    atomic_store( &m_grid_pending, 0 );
 }
 
 
@@ -319,11 +954,10 @@ MandelbrotCalc::workerThread( uint16_t a_id )
     //cout << "TS" << (int)a_id << endl;
 
     unique_lock lock( m_worker_mutex, defer_lock );
-    uint16_t    x;
-    int32_t     line, prog;
-    uint32_t *  dat;
-    double      xr, yr, zx, zy, zx2, zy2, tmp;
-    uint32_t    i, mxi;
+    uint32_t    gen = 0;    // Last work tile generation processed
+    bool        grid, prune;
+    vector<uint32_t> px;    // Pixel list passed to kernel
+    KernelStats stats;
 
     // Note: workers will run until all work is exhausted then check for exit conditions
     // This means worker count cannot be adjusted during a calculation
@@ -333,80 +967,1506 @@ MandelbrotCalc::workerThread( uint16_t a_id )
         // Wait for run notification if there is nothing to do. Note: notifications may be spurious
         // Mutex contention only occurs when workers are idle, once calc begins only atomics are used
         lock.lock();
-        if ( atomic_load( &m_y_cur ) < 0 && a_id < m_worker_count )
+        if ( gen == m_grid_gen && atomic_load( &m_tiles_pending ) == 0 && a_id < m_worker_count )
         {
             m_worker_cvar.wait(lock);
         }
+
+        // Workers join work tile processing under lock so control thread can wait for them to finish
+        prune = a_id >= m_worker_count;
+        grid = gen != m_grid_gen && !prune;
+        if ( grid )
+        {
+            gen = m_grid_gen;
+            atomic_fetch_add( &m_grid_active, 1 );
+        }
         lock.unlock();
 
         // Prune this thread if its ID is out of bounds with target worker count
-        if ( a_id >= m_worker_count )
+        if ( prune )
         {
             break;
         }
 
-        // Check if there is any work to do
-        if ( atomic_load( &m_y_cur ) > -1 )
+        // Process tiles (subdivision mode) until all are complete
+        // Note: tiles may be added by other workers, thus the queue may be temporarily empty
+        while ( atomic_load( &m_tiles_pending ) > 0 && !m_cancel )
         {
-            mxi = m_mxi;
+            Tile tile;
 
-            // Process remaining work until no more left
-            while (( line = atomic_fetch_sub( &m_y_cur, 1 )) > -1 )
             {
-                // Move to position in image to be calculated
-                dat = m_data + line*m_w;
-
-                xr = m_x1;
-                yr = m_y1 + line*m_delta;
-
-                // Iterate over current line's X-axis
-                for ( x = 0; x < m_w; x++, xr += m_delta )
-                {
-                    if ( m_cancel )
-                        break;
-
-                    // Perform calculation: Z => Z^2 + C
-
-                    i = 0;
-                    zx2 = zx = xr;
-                    zy2 = zy = yr;
-                    zx2 *= zx;
-                    zy2 *= zy;
-
-                    while ( i++ <= mxi && (( zx2 + zy2 ) < 4 ))
-                    {
-                        tmp = zx;
-                        zx2 = zx = zx2 - zy2 + xr;
-                        zy2 = zy = 2*tmp*zy + yr;
-                        zx2 *= zx;
-                        zy2 *= zy;
-                    };
-
-                    if ( i > mxi )
-                        i = 0;
-
-                    *dat++ = i;
-                }
-
-                // Update work completed
-                line = atomic_fetch_sub( &m_y_done, 1 );
-                if ( line == 1 )
+                lock_guard tile_lock( m_tile_mutex );
+                if ( m_tiles.size() )
                 {
-                    // When m_y_done reaches 0, all work has been completed
-                    // Use worker cvar to wake control thread
-                    // Taking control mutex ensure main thread is waiting on cvar
-                    lock_guard ctrl_lock( m_control_mutex );
-                    m_control_cvar.notify_all();
+                    tile = m_tiles.back();
+                    m_tiles.pop_back();
                 }
-                else if ( line == m_y_upd )
+                else
                 {
-                    prog = (m_h - line)*100/m_h;
-                    m_y_upd = (99 - prog)*m_h/100;
-                    m_observer->cbCalcProgress( prog );
+                    tile.w = 0;
                 }
             }
+
+            if ( tile.w == 0 )
+            {
+                this_thread::yield();
+                continue;
+            }
+
+            stats.interior = stats.periodic = stats.rebased = stats.rechecked = stats.samples = 0;
+            subdivideTile( tile, px, stats );
+        }
+
+        if ( grid )
+        {
+            processGrid( a_id, px, stats );
         }
     }
 
     //cout << "TX" << (int)a_id << endl;
 }
+
+
+/**
+ * @brief Divides regions of the image into work tiles ordered by estimated cost
+ * @param a_tile_size - Tile size in pixels
+ * @param a_rects - Image regions to calculate
+ *
+ * The center pixel of each tile is calculated (as a single list) with the iteration
+ * limit reduced to TILE_PROBE_ITER beyond any iterations skipped by series
+ * approximation, and its iteration count is used as the cost of the tile. Pixels that
+ * do not escape within the limit (likely in or near the set) are treated as most
+ * expensive. Tiles are sorted by increasing cost (see dealGrid). Probe results are
+ * overwritten when tiles are calculated.
+ */
+void
+MandelbrotCalc::buildGrid( uint16_t a_tile_size, const vector<Tile> & a_rects )
+{
+    vector<uint32_t>    probe;
+    vector<pair<uint32_t,Tile>> cost;
+    KernelStats         stats = { 0, 0, 0, 0, 0 };
+    uint32_t            mxi = m_mxi, c;
+
+    m_grid.clear();
+    for ( const Tile & r : a_rects )
+    {
+        const uint32_t x1 = (uint32_t)r.x + r.w, y1 = (uint32_t)r.y + r.h;
+
+        for ( uint32_t y = r.y; y < y1; y += a_tile_size )
+        {
+            for ( uint32_t x = r.x; x < x1; x += a_tile_size )
+            {
+                m_grid.push_back({ (uint16_t)x, (uint16_t)y, (uint16_t)min<uint32_t>( a_tile_size, x1 - x ), (uint16_t)min<uint32_t>( a_tile_size, y1 - y )});
+                probe.push_back((( y + m_grid.back().h/2 ) << 16 ) | ( x + m_grid.back().w/2 ));
+            }
+        }
+    }
+
+    if ( probe.empty() )
+        return;
+
+    cost.reserve( m_grid.size() );
+
+    if ( m_resume_iter || m_adapt_band )
+    {
+        // Continued pixels can't be probed, and only the samples of pixels with detail are calculated
+        // (adaptive), thus cost is the number of pixels to calculate (if any)
+        for ( const Tile & t : m_grid )
+        {
+            c = 0;
+            for ( uint32_t y = t.y; y < (uint32_t)t.y + t.h; y++ )
+            {
+                for ( uint32_t x = t.x; x < (uint32_t)t.x + t.w; x++ )
+                {
+                    c += m_resume_iter ? resumable( (size_t)y*m_w + x ) : sampled( x, y );
+                }
+            }
+
+            if ( c )
+                cost.push_back({ c, t });
+        }
+
+        m_grid.resize( cost.size() );
+    }
+    else
+    {
+        // Probes stop early, thus their orbits are not kept
+        bool keep = m_keep_orbit;
+
+        m_keep_orbit = false;
+        m_mxi = min<uint32_t>( mxi, m_sa_iter + TILE_PROBE_ITER );
+        (this->*m_kernel)( &probe[0], probe.size(), stats );
+        m_mxi = mxi;
+        m_keep_orbit = keep;
+
+        for ( size_t i = 0; i < m_grid.size(); i++ )
+        {
+            c = (*m_data)[(size_t)( probe[i] >> 16 )*m_w + ( probe[i] & 0xFFFF )];
+            cost.push_back({ c ? c : UINT32_MAX, m_grid[i] });
+        }
+    }
+
+    stable_sort( cost.begin(), cost.end(), []( const pair<uint32_t,Tile> & a, const pair<uint32_t,Tile> & b ){ return a.first < b.first; });
+
+    for ( size_t i = 0; i < m_grid.size(); i++ )
+    {
+        m_grid[i] = cost[i].second;
+    }
+}
+
+/**
+ * @brief Deals work tiles to worker queues
+ * @param a_queue_cnt - Number of queues (workers)
+ *
+ * Tiles are dealt round-robin from most to least expensive, thus each queue holds a
+ * contiguous range of m_order with similar total cost, ordered most expensive first.
+ */
+void
+MandelbrotCalc::dealGrid( uint16_t a_queue_cnt )
+{
+    uint32_t    n = m_grid.size(), pos = 0, cnt, k;
+
+    if ( m_queues.size() != a_queue_cnt )
+    {
+        m_queues = vector<WorkerQueue>( a_queue_cnt );
+    }
+
+    m_order.resize( n );
+
+    for ( uint16_t q = 0; q < a_queue_cnt; q++ )
+    {
+        cnt = n/a_queue_cnt + ( q < n % a_queue_cnt ? 1 : 0 );
+
+        for ( k = 0; k < cnt; k++ )
+        {
+            m_order[pos + k] = n - 1 - ( q + k*a_queue_cnt );
+        }
+
+        atomic_store( &m_queues[q].range, ((uint64_t)( pos + cnt ) << 32 ) | pos );
+        m_queues[q].executed = 0;
+        m_queues[q].stolen = 0;
+        m_queues[q].seed = q + 1;
+        pos += cnt;
+    }
+}
+
+/**
+ * @brief Takes a work tile from a queue
+ * @param a_queue - Queue to take from
+ * @param a_steal - If true, takes from the back of the queue (other worker), otherwise the front (owner)
+ * @return Position in m_order of tile, or -1 if queue is empty
+ *
+ * Both ends of the remaining range are held in a single atomic, thus the owner and
+ * any number of thieves may take tiles concurrently without locks.
+ */
+int32_t
+MandelbrotCalc::takeTile( WorkerQueue & a_queue, bool a_steal )
+{
+    uint64_t    range = atomic_load( &a_queue.range ), upd;
+    uint32_t    begin, end;
+
+    do
+    {
+        begin = (uint32_t)range;
+        end = (uint32_t)( range >> 32 );
+
+        if ( begin >= end )
+            return -1;
+
+        upd = a_steal ? ((uint64_t)( end - 1 ) << 32 ) | begin : ((uint64_t)end << 32 ) | ( begin + 1 );
+    }
+    while ( !atomic_compare_exchange_weak( &a_queue.range, &range, upd ));
+
+    return a_steal ? end - 1 : begin;
+}
+
+/**
+ * @brief Processes work tiles from own queue, then from other queues, until none are left
+ * @param a_id - Worker ID (queue index)
+ * @param a_px - Pixel list buffer
+ * @param a_stats - Kernel metrics buffer
+ */
+void
+MandelbrotCalc::processGrid( uint16_t a_id, vector<uint32_t> & a_px, KernelStats & a_stats )
+{
+    WorkerQueue &   own = m_queues[a_id];
+    uint16_t        cnt = m_queues.size(), v, k;
+    int32_t         pos;
+
+    while ( !m_cancel )
+    {
+        pos = takeTile( own, false );
+
+        if ( pos < 0 )
+        {
+            // Own queue is empty, try all other queues starting from a random victim (xorshift)
+            own.seed ^= own.seed << 13;
+            own.seed ^= own.seed >> 17;
+            own.seed ^= own.seed << 5;
+
+            for ( k = 0, v = own.seed % cnt; k < cnt && pos < 0; k++, v = ( v + 1 ) % cnt )
+            {
+                if ( v != a_id )
+                    pos = takeTile( m_queues[v], true );
+            }
+
+            if ( pos < 0 )
+                break;
+
+            own.stolen++;
+        }
+
+        own.executed++;
+
+        a_stats.interior = a_stats.periodic = a_stats.rebased = a_stats.rechecked = a_stats.samples = 0;
+        calcTile( m_grid[m_order[pos]], a_px, a_stats );
+        addKernelStats( a_stats );
+
+        if ( atomic_fetch_sub( &m_grid_pending, 1 ) == 1 )
+        {
+            // When m_grid_pending reaches 0, all work has been completed
+            notifyCompleted();
+        }
+    }
+
+    atomic_fetch_sub( &m_grid_active, 1 );
+}
+
+/**
+ * @brief Calculates all pixels of a work tile
+ * @param a_tile - Tile to calculate
+ * @param a_px - Pixel list buffer
+ * @param a_stats - Kernel metrics to update
+ */
+void
+MandelbrotCalc::calcTile( const Tile & a_tile, vector<uint32_t> & a_px, KernelStats & a_stats )
+{
+    const uint32_t  s = m_pass_step, x1 = (uint32_t)a_tile.x + a_tile.w, y1 = (uint32_t)a_tile.y + a_tile.h;
+    const uint32_t  sx0 = m_skip_rect.x, sx1 = sx0 + m_skip_rect.w, sy0 = m_skip_rect.y, sy1 = sy0 + m_skip_rect.h;
+    uint32_t        cnt = 0;
+    bool            skip;
+
+    // Note: a following calculation may be picked up by a worker, thus size per tile
+    a_px.resize( (uint32_t)a_tile.w*a_tile.h );
+    for ( uint32_t y = ( a_tile.y + s - 1 )/s*s; y < y1; y += s )
+    {
+        // Pixels of the skip lattice (previous pass or reused) are already known
+        skip = m_skip && y >= sy0 && y < sy1 && ( y - sy0 ) % m_skip == 0;
+
+        for ( uint32_t x = ( a_tile.x + s - 1 )/s*s; x < x1; x += s )
+        {
+            if ( skip && x >= sx0 && x < sx1 && ( x - sx0 ) % m_skip == 0 )
+                continue;
+
+            // Only pixels that did not escape within previous iteration limit are continued
+            if ( m_resume_iter && !resumable( (size_t)y*m_w + x ))
+                continue;
+
+            // Only the samples of pixels with detail are calculated (adaptive)
+            if ( m_adapt_band && !sampled( x, y ))
+                continue;
+
+            a_px[cnt++] = ( y << 16 ) | x;
+        }
+    }
+
+    if ( cnt )
+    {
+        (this->*tileKernel())( &a_px[0], cnt, a_stats );
+        a_stats.samples += cnt;
+        updateProgress( cnt );
+    }
+}
+
+/**
+ * @brief Returns the kernel to calculate a tile with
+ * @return Kernel of calculation, or the double kernel replacing an automatically selected float kernel
+ *
+ * The float kernel is only faster while few pixels need to be recalculated in double precision, thus
+ * an automatically selected float kernel is replaced while the pixels recalculated so far exceed
+ * FLOAT_AUTO_RECHECK of the samples calculated so far (counts are updated as tiles complete).
+ */
+MandelbrotCalc::Kernel
+MandelbrotCalc::tileKernel()
+{
+    if ( m_float_fallback && atomic_load( &m_recheck_cnt ) > atomic_load( &m_sample_cnt )*FLOAT_AUTO_RECHECK )
+    {
+        return m_float_fallback;
+    }
+
+    return m_kernel;
+}
+
+/**
+ * @brief Fills a partial image from the pixels calculated by progressive passes so far
+ * @param a_dst - Partial image (sized here)
+ *
+ * Each pixel is set to the value of the nearest lattice pixel (of the current pass
+ * spacing) at or below/left of it. The image being calculated is not modified.
+ */
+void
+MandelbrotCalc::fillPass( IterBuffer & a_dst )
+{
+    const uint32_t  s = m_pass_step;
+
+    a_dst.assign( m_data->size(), m_data->wide() );
+
+    m_data->visit( [&]( const auto * a_src )
+    {
+        a_dst.visit( [&]( auto * a_data )
+        {
+            for ( uint32_t y = 0; y < m_h; y++ )
+            {
+                auto * row = a_data + (size_t)y*m_w;
+
+                if ( y % s )
+                {
+                    // Copy (filled) lattice line below
+                    auto * src = row - (size_t)( y % s )*m_w;
+                    copy( src, src + m_w, row );
+                }
+                else
+                {
+                    const auto * src = a_src + (size_t)y*m_w;
+
+                    for ( uint32_t x = 0; x < m_w; x++ )
+                    {
+                        row[x] = src[x - x % s];
+                    }
+                }
+            }
+        });
+    });
+}
+
+/**
+ * @brief Queues work tiles (or subdivision tiles) covering regions of the image
+ * @param a_result - Calculation result (tile size is set)
+ * @param a_rects - Image regions to calculate (work tiles only, subdivision covers the image)
+ * @param a_px - Pixels to calculate (used for automatic tile size)
+ */
+void
+MandelbrotCalc::queueWork( Result & a_result, const vector<Tile> & a_rects, uint64_t a_px )
+{
+    if ( m_params.subdivide )
+    {
+        // Seed tile queue with initial tiles covering the image
+        // Note: a worker that was late to the previous band may still be checking the queue
+        lock_guard tile_lock( m_tile_mutex );
+
+        m_tiles.clear();
+        for ( uint32_t y = 0; y < m_h; y += MS_TILE_SIZE )
+        {
+            for ( uint32_t x = 0; x < m_w; x += MS_TILE_SIZE )
+            {
+                m_tiles.push_back({ (uint16_t)x, (uint16_t)y, (uint16_t)min<uint32_t>( MS_TILE_SIZE, m_w - x ), (uint16_t)min<uint32_t>( MS_TILE_SIZE, m_h - y )});
+            }
+        }
+
+        a_result.tile_size = MS_TILE_SIZE;
+        atomic_store( &m_tiles_pending, (int32_t)m_tiles.size() );
+    }
+    else
+    {
+        // Auto tile size gives each thread several tiles to balance load
+        a_result.tile_size = m_params.tile_size;
+        if ( !a_result.tile_size )
+        {
+            double size = sqrt( (double)a_px/( max<uint16_t>( m_params.th_cnt, 1 )*TILE_PER_THREAD ));
+            a_result.tile_size = (uint16_t)min( max( size, (double)TILE_SIZE_MIN ), (double)TILE_SIZE_MAX );
+        }
+
+        buildGrid( a_result.tile_size, a_rects );
+    }
+}
+
+/**
+ * @brief Sets up the next band of a supersampled calculation
+ * @param a_result - Calculation result (tile size is set)
+ * @return True if a band was set up, false if all bands are done
+ *
+ * Bands are rectangles of image pixels, taken in line order, sized so that their samples
+ * (ss x ss per pixel) do not exceed SS_BAND_SAMPLES (unless a single pixel does). While a
+ * band is calculated, the image size (m_w, m_h) and coordinate tables are those of its
+ * samples, and kernels write to the band buffer. Work is then queued as for a whole image.
+ */
+bool
+MandelbrotCalc::nextBand( Result & a_result )
+{
+    const uint32_t  n = (uint32_t)m_ss*m_ss;
+    const uint16_t  bw = (uint16_t)min<uint32_t>( m_ss_w, max<uint32_t>( SS_BAND_SAMPLES/n, 1 ));
+    const uint16_t  bh = (uint16_t)min<uint32_t>( m_ss_h, max<uint32_t>( SS_BAND_SAMPLES/( n*max<uint16_t>( bw, 1 )), 1 ));
+    uint32_t        x = 0, y = 0;
+
+    if ( m_band.w )
+    {
+        x = (uint32_t)m_band.x + m_band.w;
+        y = m_band.y;
+        if ( x >= m_ss_w )
+        {
+            x = 0;
+            y += m_band.h;
+        }
+    }
+
+    if ( x >= m_ss_w || y >= m_ss_h )
+    {
+        m_band.w = 0;
+        return false;
+    }
+
+    m_band = { (uint16_t)x, (uint16_t)y, (uint16_t)min<uint32_t>( bw, m_ss_w - x ), (uint16_t)min<uint32_t>( bh, m_ss_h - y )};
+    m_w = m_band.w*m_ss;
+    m_h = m_band.h*m_ss;
+
+    setSampleCoords( a_result.kernel, (uint32_t)m_band.x*m_ss, (uint32_t)m_band.y*m_ss, 1 );
+
+    // Adaptive bands only calculate the samples of pixels with detail (see sampled)
+    m_adapt_band = m_adaptive;
+    m_band_data.assign( (size_t)m_w*m_h, a_result.img_data.wide() );
+
+    queueWork( a_result, { Tile{ 0, 0, m_w, m_h }}, (uint64_t)m_w*m_h );
+
+    return true;
+}
+
+/**
+ * @brief Sets the coordinate tables to sample columns and lines of a supersampled image
+ * @param a_kernel - Kernel type (only tables used by the kernel are set)
+ * @param a_x - First sample column
+ * @param a_y - First sample line
+ * @param a_step - Sample columns and lines between table entries
+ *
+ * Tables are set for the image size (m_w, m_h), from the tables of all samples (plus jitter).
+ */
+void
+MandelbrotCalc::setSampleCoords( KernelType a_kernel, uint32_t a_x, uint32_t a_y, uint32_t a_step )
+{
+    size_t      k;
+
+    m_cx.resize( m_w );
+    m_cy.resize( m_h );
+
+    for ( uint32_t i = 0; i < m_w; i++ )
+    {
+        k = a_x + (size_t)i*a_step;
+        m_cx[i] = m_ss_cx[k] + m_jit_x[k];
+    }
+
+    for ( uint32_t i = 0; i < m_h; i++ )
+    {
+        k = a_y + (size_t)i*a_step;
+        m_cy[i] = m_ss_cy[k] + m_jit_y[k];
+    }
+
+    if ( a_kernel == KT_FLOAT )
+    {
+        m_cx_f.resize( m_w );
+        m_cy_f.resize( m_h );
+
+        for ( uint32_t i = 0; i < m_w; i++ )
+        {
+            k = a_x + (size_t)i*a_step;
+            m_cx_f[i] = m_ss_cx_f[k] + (float)m_jit_x[k];
+        }
+
+        for ( uint32_t i = 0; i < m_h; i++ )
+        {
+            k = a_y + (size_t)i*a_step;
+            m_cy_f[i] = m_ss_cy_f[k] + (float)m_jit_y[k];
+        }
+    }
+    else if ( a_kernel == KT_DOUBLE_DOUBLE )
+    {
+        m_cx_dd.resize( m_w );
+        m_cy_dd.resize( m_h );
+
+        for ( uint32_t i = 0; i < m_w; i++ )
+        {
+            k = a_x + (size_t)i*a_step;
+            m_cx_dd[i] = m_ss_cx_dd[k] + DoubleDouble( m_jit_x[k] );
+        }
+
+        for ( uint32_t i = 0; i < m_h; i++ )
+        {
+            k = a_y + (size_t)i*a_step;
+            m_cy_dd[i] = m_ss_cy_dd[k] + DoubleDouble( m_jit_y[k] );
+        }
+    }
+}
+
+/**
+ * @brief Marks the pixels with detail from their base samples (adaptive supersampling)
+ * @return Number of pixels with detail
+ *
+ * A pixel has detail if the count of its base sample differs by more than SS_DETAIL_TOL
+ * from that of any of its 8 neighbors, or if either is interior (count of 0) but not both.
+ * Only the samples of these pixels are calculated by the bands that follow; other pixels
+ * keep their base sample.
+ */
+uint64_t
+MandelbrotCalc::markDetail()
+{
+    const uint32_t  w = m_ss_w, h = m_ss_h;
+    uint64_t        cnt = 0;
+
+    m_detail.assign( (size_t)w*h, 0 );
+
+    m_base.visit( [&]( const auto * a_base )
+    {
+        // Each pair of neighbors is compared once (right, and the three below), both are marked
+        auto diff = [&]( size_t a_i, size_t a_j )
+        {
+            uint32_t    u = a_base[a_i], v = a_base[a_j];
+
+            if (( u == 0 ) != ( v == 0 ) || ( u > v ? u - v : v - u ) > SS_DETAIL_TOL )
+            {
+                m_detail[a_i] = 1;
+                m_detail[a_j] = 1;
+            }
+        };
+
+        for ( uint32_t y = 0; y < h; y++ )
+        {
+            for ( uint32_t x = 0; x < w; x++ )
+            {
+                size_t  i = (size_t)y*w + x;
+
+                if ( x + 1 < w )
+                    diff( i, i + 1 );
+
+                if ( y + 1 < h )
+                {
+                    diff( i, i + w );
+
+                    if ( x > 0 )
+                        diff( i, i + w - 1 );
+
+                    if ( x + 1 < w )
+                        diff( i, i + w + 1 );
+                }
+            }
+        }
+    });
+
+    for ( uint8_t d : m_detail )
+    {
+        cnt += d;
+    }
+
+    return cnt;
+}
+
+/**
+ * @brief Determines if a sample of the current band is calculated (adaptive supersampling)
+ * @param a_x - Band sample column
+ * @param a_y - Band sample line
+ * @return True if sample is of a pixel with detail, and is not its base sample
+ */
+bool
+MandelbrotCalc::sampled( uint32_t a_x, uint32_t a_y ) const
+{
+    const uint32_t  c = m_ss/2u;
+
+    return m_detail[(size_t)( m_band.y + a_y/m_ss )*m_ss_w + m_band.x + a_x/m_ss] && ( a_x % m_ss != c || a_y % m_ss != c );
+}
+
+/**
+ * @brief Reduces the samples of a completed band into the image
+ * @param a_result - Calculation result (image data receives kept samples)
+ * @param a_band - Band (image pixels) whose samples are in m_band_done
+ *
+ * If all samples are kept (m_keep is ss), they are copied. Otherwise (reduced supersampling)
+ * the ss x ss samples of each pixel are sorted by count, and m_keep x m_keep of them are
+ * kept: the median of each equal share of the sorted samples. The kept samples are a
+ * quantile summary of the counts of the pixel, thus averaging their colors (for any palette)
+ * approximates the average color of all samples. Interior samples (count of 0) sort first,
+ * and are kept in proportion. Kept samples are stored in the image as a square block per
+ * pixel (a supersampled image with a factor of m_keep, see Result::ss).
+ *
+ * With adaptive supersampling, the base sample of each pixel is taken from the base pass,
+ * and pixels without detail keep only their base sample (all kept samples are set to it).
+ */
+void
+MandelbrotCalc::reduceBand( Result & a_result, const Tile & a_band )
+{
+    const uint32_t  ss = m_ss, n = ss*ss, kp = m_keep, k_cnt = kp*kp, bw = (uint32_t)a_band.w*ss, c = ss/2;
+    const size_t    w = a_result.img_width;
+    vector<uint32_t> smp( n );
+
+    m_band_done.visit( [&]( const auto * a_src )
+    {
+        a_result.img_data.visit( [&]( auto * a_dst )
+        {
+            for ( uint32_t py = 0; py < a_band.h; py++ )
+            {
+                for ( uint32_t px = 0; px < a_band.w; px++ )
+                {
+                    const size_t    pix = ( (size_t)a_band.y + py )*m_ss_w + a_band.x + px;
+                    const auto *    src = a_src + (size_t)py*ss*bw + px*ss;
+                    auto *          dst = a_dst + ( (size_t)a_band.y + py )*kp*w + ( (size_t)a_band.x + px )*kp;
+                    uint32_t        cnt = 0, v, i, j;
+
+                    if ( m_adaptive && !m_detail[pix] )
+                    {
+                        for ( i = 0; i < k_cnt; i++ )
+                        {
+                            dst[( i / kp )*w + i % kp] = m_base[pix];
+                        }
+                        continue;
+                    }
+
+                    if ( kp == ss )
+                    {
+                        for ( j = 0; j < ss; j++, src += bw )
+                        {
+                            for ( i = 0; i < ss; i++ )
+                            {
+                                dst[j*w + i] = m_adaptive && i == c && j == c ? m_base[pix] : src[i];
+                            }
+                        }
+                        continue;
+                    }
+
+                    // Insertion sort of samples (few per pixel)
+                    for ( j = 0; j < ss; j++, src += bw )
+                    {
+                        for ( i = 0; i < ss; i++ )
+                        {
+                            v = m_adaptive && i == c && j == c ? m_base[pix] : src[i];
+                            uint32_t p = cnt++;
+                            for ( ; p > 0 && smp[p - 1] > v; p-- )
+                            {
+                                smp[p] = smp[p - 1];
+                            }
+                            smp[p] = v;
+                        }
+                    }
+
+                    for ( i = 0; i < k_cnt; i++ )
+                    {
+                        dst[( i / kp )*w + i % kp] = smp[( 2*i + 1 )*n/( 2*k_cnt )];
+                    }
+                }
+            }
+        });
+    });
+}
+
+/**
+ * @brief Determines if pixels of the previous result can be reused by a new calculation
+ * @param a_result - Result of new calculation (image size and kernel selected)
+ * @return True if previous pixels can be reused
+ *
+ * The previous calculation must have completed with the same origin, iteration limit,
+ * kernel, and periodicity option. The pixel spacing of the new image must be an integer
+ * multiple or fraction of the previous spacing (i.e. zooming by an integer factor), and
+ * the images must be offset by whole pixels of the finer spacing (within REUSE_TOL).
+ * Only the double and float kernels are supported, as perturbation results depend on
+ * the reference orbit at the image center.
+ *
+ * If pixels can be reused, the pixel spacing is set to the exact ratio of the previous
+ * spacing and the previous column and line of each image column and line (if any) are
+ * set in m_reuse_x and m_reuse_y.
+ */
+bool
+MandelbrotCalc::checkReuse( const Result & a_result )
+{
+    if ( !m_params.reuse || m_params.subdivide || m_prev.img_data.empty() ||
+         ( a_result.kernel != KT_DOUBLE && a_result.kernel != KT_FLOAT ) || a_result.kernel != m_prev.kernel ||
+         a_result.x0 != m_prev.x0 || a_result.y0 != m_prev.y0 || a_result.iter_mx != m_prev.iter_mx ||
+         m_params.periodicity != m_prev_periodicity )
+    {
+        return false;
+    }
+
+    // Spacing ratio num/den, one of which is 1
+    double      ratio = m_delta/m_prev_delta;
+    uint32_t    num = ratio >= 1 ? (uint32_t)lround( ratio ) : 1;
+    uint32_t    den = ratio < 1 ? (uint32_t)lround( 1/ratio ) : 1;
+
+    if ( num > REUSE_MAX_SCALE || den > REUSE_MAX_SCALE )
+    {
+        return false;
+    }
+
+    // Offset of new image in pixels of finer spacing
+    double      unit = m_prev_delta/den;
+    double      fx = ( a_result.x1 - m_prev.x1 )/unit;
+    double      fy = ( a_result.y1 - m_prev.y1 )/unit;
+    int64_t     ox = llround( fx ), oy = llround( fy );
+
+    // Spacing difference must not add up to more than the tolerance across the image
+    if ( fabs( fx - ox ) > REUSE_TOL || fabs( fy - oy ) > REUSE_TOL ||
+         fabs( m_delta - m_prev_delta*num/den )*max( a_result.img_width, a_result.img_height ) > REUSE_TOL*unit )
+    {
+        return false;
+    }
+
+    m_delta = m_prev_delta*num/den;
+
+    mapAxis( m_reuse_x, a_result.img_width, m_prev.img_width, num, den, ox );
+    mapAxis( m_reuse_y, a_result.img_height, m_prev.img_height, num, den, oy );
+
+    return *max_element( m_reuse_x.begin(), m_reuse_x.end() ) >= 0 && *max_element( m_reuse_y.begin(), m_reuse_y.end() ) >= 0;
+}
+
+/**
+ * @brief Maps the pixels of an image axis to pixels of the previous image
+ * @param a_map - Receives previous pixel of each pixel (-1 if none)
+ * @param a_cnt - Number of pixels
+ * @param a_prev_cnt - Number of pixels of previous image
+ * @param a_num - Spacing ratio numerator
+ * @param a_den - Spacing ratio denominator
+ * @param a_off - Offset of first pixel in previous image (in pixels of finer spacing)
+ *
+ * Pixel i coincides with previous pixel (i.num + off)/den if the division is exact.
+ */
+void
+MandelbrotCalc::mapAxis( vector<int32_t> & a_map, uint16_t a_cnt, uint16_t a_prev_cnt, uint32_t a_num, uint32_t a_den, int64_t a_off )
+{
+    int64_t q;
+
+    a_map.resize( a_cnt );
+    for ( uint32_t i = 0; i < a_cnt; i++ )
+    {
+        q = (int64_t)i*a_num + a_off;
+        a_map[i] = q >= 0 && q % a_den == 0 && q/a_den < a_prev_cnt ? (int32_t)( q/a_den ) : -1;
+    }
+}
+
+/**
+ * @brief Determines the regions of the image to calculate when reusing previous pixels
+ * @param a_rects - Receives regions of image to calculate
+ * @return Number of reused pixels
+ *
+ * Reused pixels are either a block (same or coarser spacing than previous image), in
+ * which case the regions around it are calculated, or a lattice (finer spacing), in
+ * which case the whole image is calculated except the lattice (see m_skip).
+ */
+uint64_t
+MandelbrotCalc::reuseRegions( vector<Tile> & a_rects )
+{
+    uint16_t    x0 = 0, x1 = 0, y0 = 0, y1 = 0, nx = 0, ny = 0;
+
+    // Bounds and number of reused columns and lines (maps are monotonic)
+    for ( uint16_t x = 0; x < m_w; x++ )
+    {
+        if ( m_reuse_x[x] >= 0 )
+        {
+            x0 = nx++ ? x0 : x;
+            x1 = x + 1;
+        }
+    }
+
+    for ( uint16_t y = 0; y < m_h; y++ )
+    {
+        if ( m_reuse_y[y] >= 0 )
+        {
+            y0 = ny++ ? y0 : y;
+            y1 = y + 1;
+        }
+    }
+
+    if ( nx < x1 - x0 || ny < y1 - y0 )
+    {
+        // Lattice with spacing of ratio
+        m_skip = nx > 1 ? ( x1 - x0 - 1 )/( nx - 1 ) : ( y1 - y0 - 1 )/( ny - 1 );
+        m_skip_rect = { x0, y0, (uint16_t)( x1 - x0 ), (uint16_t)( y1 - y0 )};
+        a_rects.push_back({ 0, 0, m_w, m_h });
+    }
+    else
+    {
+        // Lines below/above block, then columns left/right of it
+        if ( y0 > 0 )
+            a_rects.push_back({ 0, 0, m_w, y0 });
+        if ( y1 < m_h )
+            a_rects.push_back({ 0, y1, m_w, (uint16_t)( m_h - y1 )});
+        if ( x0 > 0 )
+            a_rects.push_back({ 0, y0, x0, (uint16_t)( y1 - y0 )});
+        if ( x1 < m_w )
+            a_rects.push_back({ x1, y0, (uint16_t)( m_w - x1 ), (uint16_t)( y1 - y0 )});
+    }
+
+    return (uint64_t)nx*ny;
+}
+
+/**
+ * @brief Copies reused pixels of the previous image to the image buffer
+ */
+void
+MandelbrotCalc::reuseImage()
+{
+    for ( uint16_t y = 0; y < m_h; y++ )
+    {
+        if ( m_reuse_y[y] < 0 )
+            continue;
+
+        // Previous and current counts may differ in width (see IterBuffer)
+        m_prev.img_data.visit( [&]( const auto * a_prev )
+        {
+            m_data->visit( [&]( auto * a_data )
+            {
+                const auto *    src = a_prev + (size_t)m_reuse_y[y]*m_prev.img_width;
+                auto *          dst = a_data + (size_t)y*m_w;
+
+                for ( uint16_t x = 0; x < m_w; x++ )
+                {
+                    if ( m_reuse_x[x] >= 0 )
+                        dst[x] = src[m_reuse_x[x]];
+                }
+            });
+        });
+
+        if ( m_keep_orbit )
+        {
+            for ( uint16_t x = 0; x < m_w; x++ )
+            {
+                const KeptOrbit * o;
+
+                if ( m_reuse_x[x] >= 0 && (*m_data)[(size_t)y*m_w + x] == 0 &&
+                     ( o = findOrbit( m_prev_orbit, (size_t)m_reuse_y[y]*m_prev.img_width + m_reuse_x[x] )))
+                {
+                    m_orbits.push_back({ (size_t)y*m_w + x, o->z });
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Determines if the previous result can be continued or derived from by a new calculation
+ * @param a_result - Result of new calculation (image size and kernel selected)
+ * @return True if previous result can be continued (higher iteration limit) or derived from (lower)
+ *
+ * The previous calculation must have completed for the same view (origin, bounding points,
+ * and image size) with the same periodicity option but a different iteration limit. Only
+ * the double and float kernels are supported. Continuing also requires the orbits of the
+ * previous result (see m_prev_orbit).
+ */
+bool
+MandelbrotCalc::checkResume( const Result & a_result )
+{
+    if ( !m_params.resume || m_params.subdivide || m_prev.img_data.empty() ||
+         ( a_result.kernel != KT_DOUBLE && a_result.kernel != KT_FLOAT ) ||
+         a_result.x0 != m_prev.x0 || a_result.y0 != m_prev.y0 || a_result.x1 != m_prev.x1 || a_result.y1 != m_prev.y1 ||
+         a_result.x2 != m_prev.x2 || a_result.y2 != m_prev.y2 || a_result.img_width != m_prev.img_width ||
+         a_result.img_height != m_prev.img_height || a_result.iter_mx == m_prev.iter_mx ||
+         m_params.periodicity != m_prev_periodicity )
+    {
+        return false;
+    }
+
+    if ( a_result.iter_mx > m_prev.iter_mx && !m_prev_kept )
+    {
+        return false;
+    }
+
+    // Spacing of previous calculation may have been adjusted for reuse
+    m_delta = m_prev_delta;
+
+    return true;
+}
+
+/**
+ * @brief Derives the image for a lower iteration limit from the previous image
+ * @param a_result - Result of new calculation (receives image)
+ *
+ * Pixels that escaped beyond the new limit are set to 0, all other counts are the same as
+ * they would be if calculated. The previous result is kept, thus the limit may be raised
+ * again up to the previous limit without calculation, or above it by continuing orbits.
+ */
+void
+MandelbrotCalc::deriveImage( Result & a_result )
+{
+    const uint32_t mxi = a_result.iter_mx;
+
+    a_result.img_data.assign( m_prev.img_data.size(), !IterBuffer::fits16( mxi ));
+    m_prev.img_data.visit( [&]( const auto * a_src )
+    {
+        a_result.img_data.visit( [&]( auto * a_dst )
+        {
+            transform( a_src, a_src + m_prev.img_data.size(), a_dst, [mxi]( uint32_t a_i ){ return a_i > mxi ? 0 : a_i; });
+        });
+    });
+
+    a_result.kernel = m_prev.kernel;
+    a_result.simd = m_prev.simd;
+    a_result.interior_cnt = 0;
+    a_result.periodic_cnt = 0;
+    a_result.filled_cnt = 0;
+    a_result.rebase_cnt = 0;
+    a_result.skip_iter = 0;
+    a_result.recheck_cnt = 0;
+    a_result.sample_cnt = 0;
+    a_result.tile_size = 0;
+    a_result.reused_cnt = a_result.img_data.size();
+    a_result.resumed_cnt = 0;
+}
+
+/**
+ * @brief Determines if a pixel is continued by a resumed calculation
+ * @param a_idx - Pixel index
+ * @return True if pixel did not escape within the previous limit and may still escape
+ */
+bool
+MandelbrotCalc::resumable( size_t a_idx ) const
+{
+    return (*m_data)[a_idx] == 0 && findOrbit( m_resume_orbit, a_idx );
+}
+
+/**
+ * @brief Finds the kept orbit of a pixel
+ * @param a_orbits - Kept orbits (sorted by pixel)
+ * @param a_idx - Pixel index
+ * @return Kept orbit, or null if none (pixel escaped, is periodic, or was not calculated)
+ */
+const MandelbrotCalc::KeptOrbit *
+MandelbrotCalc::findOrbit( const vector<KeptOrbit> & a_orbits, size_t a_idx )
+{
+    vector<KeptOrbit>::const_iterator o = lower_bound( a_orbits.begin(), a_orbits.end(), a_idx,
+        []( const KeptOrbit & a, size_t b ){ return a.idx < b; });
+
+    return o != a_orbits.end() && o->idx == a_idx ? &*o : 0;
+}
+
+/**
+ * @brief Adds orbits kept by a kernel call to those of the calculation
+ * @param a_kept - Kept orbits (any order)
+ *
+ * Kernels collect orbits per call (work tile), thus the lock is taken once per tile.
+ */
+void
+MandelbrotCalc::keepOrbits( const vector<KeptOrbit> & a_kept )
+{
+    if ( a_kept.empty() )
+        return;
+
+    lock_guard lock( m_orbit_mutex );
+    m_orbits.insert( m_orbits.end(), a_kept.begin(), a_kept.end() );
+}
+
+/**
+ * @brief Sets the tile cache lattice of the image
+ * @param a_result - Result of new calculation
+ * @param a_ox - Real coordinate of origin
+ * @param a_oy - Imaginary coordinate of origin
+ *
+ * The lattice is the complex plane divided into pixels of the image spacing, offset such
+ * that the image pixels lie on it. Pixel spacing and offset are quantized (see CACHE_SPACING
+ * and CACHE_PHASE) to form the key, thus images on nearly the same lattice share tiles.
+ */
+void
+MandelbrotCalc::cacheLattice( const Result & a_result, double a_ox, double a_oy )
+{
+    // Position of first pixel on the lattice in sub-pixel steps
+    int64_t px = llround(( a_ox + a_result.x1 )/m_delta*CACHE_PHASE );
+    int64_t py = llround(( a_oy + a_result.y1 )/m_delta*CACHE_PHASE );
+
+    m_lat_x = floorDiv( px, CACHE_PHASE );
+    m_lat_y = floorDiv( py, CACHE_PHASE );
+    m_lat_cx = a_ox + a_result.x1;
+    m_lat_cy = a_oy + a_result.y1;
+
+    m_lat_key.spacing = llround( log2( m_delta )*CACHE_SPACING );
+    m_lat_key.phase_x = (uint16_t)( px - m_lat_x*CACHE_PHASE );
+    m_lat_key.phase_y = (uint16_t)( py - m_lat_y*CACHE_PHASE );
+    m_lat_key.iter_mx = a_result.iter_mx;
+    m_lat_key.variant = a_result.kernel | ( m_params.periodicity ? 0x80 : 0 );
+}
+
+/**
+ * @brief Checks if the pixels of a cached tile coincide with the image pixels
+ * @param a_delta - Pixel spacing of tile
+ * @param a_cx - Real coordinate of tile column 0
+ * @param a_cy - Imaginary coordinate of tile line 0
+ * @param a_tx - Tile column on lattice
+ * @param a_ty - Tile line on lattice
+ * @return True if pixels coincide
+ *
+ * Keys are quantized, thus spacing and position must be checked (as for reuse).
+ */
+bool
+MandelbrotCalc::cacheMatch( double a_delta, double a_cx, double a_cy, int64_t a_tx, int64_t a_ty ) const
+{
+    const double tol = REUSE_TOL*m_delta;
+
+    return fabs( a_delta - m_delta )*TileCache::SIZE <= tol &&
+           fabs( a_cx - ( m_lat_cx + ( a_tx*TileCache::SIZE - m_lat_x )*m_delta )) <= tol &&
+           fabs( a_cy - ( m_lat_cy + ( a_ty*TileCache::SIZE - m_lat_y )*m_delta )) <= tol;
+}
+
+/**
+ * @brief Finds a tile of the image lattice in the tile cache
+ * @param a_tx - Tile column on lattice
+ * @param a_ty - Tile line on lattice
+ * @return Tile, or null if not cached or if its pixels do not coincide with image pixels
+ */
+TileCache::Entry *
+MandelbrotCalc::cacheFind( int64_t a_tx, int64_t a_ty )
+{
+    TileCache::Key      key = m_lat_key;
+    TileCache::Entry *  e;
+
+    key.x = a_tx;
+    key.y = a_ty;
+
+    e = m_cache.find( key );
+
+    return e && cacheMatch( e->delta, e->cx, e->cy, a_tx, a_ty ) ? e : 0;
+}
+
+/**
+ * @brief Finds a tile of the image lattice in the persistent tile store
+ * @param a_tx - Tile column on lattice
+ * @param a_ty - Tile line on lattice
+ * @return Tile (valid until next store update), or null if not stored, if the store is not
+ * open, or if its pixels do not coincide with image pixels
+ */
+const TileStore::Record *
+MandelbrotCalc::storeFind( int64_t a_tx, int64_t a_ty )
+{
+    TileCache::Key              key = m_lat_key;
+    const TileStore::Record *   r;
+
+    if ( m_store.dir().empty() )
+        return 0;
+
+    key.x = a_tx;
+    key.y = a_ty;
+
+    r = m_store.find( key );
+
+    return r && cacheMatch( r->delta, r->cx, r->cy, a_tx, a_ty ) ? r : 0;
+}
+
+/**
+ * @brief Fills parts of regions to calculate from the tile cache
+ * @param a_rects - Regions to calculate (replaced by the parts not filled)
+ * @param a_result - Result of new calculation (receives hit and miss counts)
+ * @return Number of pixels filled (excluding reused pixels of skip lattice)
+ *
+ * Regions are split on tile boundaries. A part is filled if the tile is cached (in memory,
+ * or else in the persistent store) and its valid region covers the part; otherwise the
+ * part is left to be calculated. Stored tiles are copied from the mapped store.
+ */
+uint64_t
+MandelbrotCalc::cacheFill( vector<Tile> & a_rects, Result & a_result )
+{
+    const int64_t       ts = TileCache::SIZE;
+    vector<Tile>                miss;
+    TileCache::Entry *          e;
+    const TileStore::Record *   rec;
+    const uint32_t *            src;
+    size_t                      stride;
+    int64_t                     bx, by;
+    uint32_t                    x0, x1, y0, y1, y;
+    uint64_t                    cnt = 0;
+
+    // Number of pixels of the skip lattice in an image range
+    auto skipCount = []( uint32_t a_x0, uint32_t a_x1, uint32_t a_s0, uint32_t a_s1, uint32_t a_skip ) -> uint64_t
+    {
+        a_x0 = max( a_x0, a_s0 );
+        a_x1 = min( a_x1, a_s1 );
+
+        return a_x1 > a_x0 ? ( a_x1 - a_s0 + a_skip - 1 )/a_skip - ( a_x0 - a_s0 + a_skip - 1 )/a_skip : 0;
+    };
+
+    for ( const Tile & r : a_rects )
+    {
+        for ( int64_t ty = floorDiv( m_lat_y + r.y, ts ); ( by = ty*ts - m_lat_y ) < r.y + r.h; ty++ )
+        {
+            y0 = max<int64_t>( by, r.y );
+            y1 = min<int64_t>( by + ts, r.y + r.h );
+
+            for ( int64_t tx = floorDiv( m_lat_x + r.x, ts ); ( bx = tx*ts - m_lat_x ) < r.x + r.w; tx++ )
+            {
+                x0 = max<int64_t>( bx, r.x );
+                x1 = min<int64_t>( bx + ts, r.x + r.w );
+
+                // Valid region of tile must cover part
+                auto covers = [&]( uint16_t a_x, uint16_t a_y, uint16_t a_w, uint16_t a_h )
+                {
+                    return a_x <= x0 - bx && a_x + a_w >= x1 - bx && a_y <= y0 - by && a_y + a_h >= y1 - by;
+                };
+
+                src = 0;
+                e = cacheFind( tx, ty );
+
+                if ( e && covers( e->x, e->y, e->w, e->h ))
+                {
+                    src = &e->data[( y0 - by )*ts + ( x0 - bx )];
+                    stride = ts;
+                }
+                else if (( rec = storeFind( tx, ty )) && covers( rec->x, rec->y, rec->w, rec->h ))
+                {
+                    src = rec->data() + ( y0 - by - rec->y )*rec->w + ( x0 - bx - rec->x );
+                    stride = rec->w;
+                    a_result.store_hit_cnt++;
+                }
+
+                if ( src )
+                {
+                    m_data->visit( [&]( auto * a_data )
+                    {
+                        for ( y = y0; y < y1; y++, src += stride )
+                        {
+                            copy( src, src + ( x1 - x0 ), a_data + (size_t)y*m_w + x0 );
+                        }
+                    });
+
+                    cnt += (uint64_t)( x1 - x0 )*( y1 - y0 );
+                    if ( m_skip )
+                    {
+                        cnt -= skipCount( x0, x1, m_skip_rect.x, m_skip_rect.x + m_skip_rect.w, m_skip )*
+                               skipCount( y0, y1, m_skip_rect.y, m_skip_rect.y + m_skip_rect.h, m_skip );
+                    }
+
+                    a_result.cache_hit_cnt++;
+                }
+                else
+                {
+                    miss.push_back({ (uint16_t)x0, (uint16_t)y0, (uint16_t)( x1 - x0 ), (uint16_t)( y1 - y0 )});
+                    a_result.cache_miss_cnt++;
+                }
+            }
+        }
+    }
+
+    a_rects.swap( miss );
+
+    return cnt;
+}
+
+/**
+ * @brief Stores the tiles of the (completed) image in the tile cache
+ *
+ * Tiles already cached with a valid region covering the image are only marked as
+ * recently used. If the valid region and the image part of a cached tile form a
+ * rectangle, the tile is extended; otherwise the larger of the two is kept. Updated
+ * tiles are also appended to the persistent store (if open) unless already stored
+ * with a covering valid region.
+ */
+void
+MandelbrotCalc::cacheStore()
+{
+    const int64_t       ts = TileCache::SIZE;
+    TileCache::Entry *  e;
+    TileCache::Key      key = m_lat_key;
+    TileStore::Record   rec;
+    int64_t             bx, by;
+    uint32_t            x0, x1, y0, y1, y;
+    uint16_t            ux0, ux1, uy0, uy1;
+
+    for ( int64_t ty = floorDiv( m_lat_y, ts ); ( by = ty*ts - m_lat_y ) < m_h; ty++ )
+    {
+        y0 = max<int64_t>( by, 0 );
+        y1 = min<int64_t>( by + ts, m_h );
+
+        for ( int64_t tx = floorDiv( m_lat_x, ts ); ( bx = tx*ts - m_lat_x ) < m_w; tx++ )
+        {
+            x0 = max<int64_t>( bx, 0 );
+            x1 = min<int64_t>( bx + ts, m_w );
+
+            e = cacheFind( tx, ty );
+
+            if ( e && e->x <= x0 - bx && e->x + e->w >= x1 - bx && e->y <= y0 - by && e->y + e->h >= y1 - by )
+                continue;
+
+            // Union of valid region and image part (in tile coordinates)
+            ux0 = x0 - bx;
+            ux1 = x1 - bx;
+            uy0 = y0 - by;
+            uy1 = y1 - by;
+
+            if ( e )
+            {
+                if (( e->x == ux0 && e->w == ux1 - ux0 && e->y <= uy1 && e->y + e->h >= uy0 ) ||
+                    ( e->y == uy0 && e->h == uy1 - uy0 && e->x <= ux1 && e->x + e->w >= ux0 ))
+                {
+                    ux0 = min( ux0, e->x );
+                    ux1 = max<uint16_t>( ux1, e->x + e->w );
+                    uy0 = min( uy0, e->y );
+                    uy1 = max<uint16_t>( uy1, e->y + e->h );
+                }
+                else if ((uint32_t)e->w*e->h >= ( x1 - x0 )*( y1 - y0 ))
+                {
+                    continue;
+                }
+            }
+
+            key.x = tx;
+            key.y = ty;
+            e = &m_cache.insert( key );
+            e->delta = m_delta;
+            e->cx = m_lat_cx + bx*m_delta;
+            e->cy = m_lat_cy + by*m_delta;
+            e->x = ux0;
+            e->y = uy0;
+            e->w = ux1 - ux0;
+            e->h = uy1 - uy0;
+
+            m_data->visit( [&]( const auto * a_data )
+            {
+                for ( y = y0; y < y1; y++ )
+                {
+                    const auto * src = a_data + (size_t)y*m_w + x0;
+                    copy( src, src + ( x1 - x0 ), &e->data[( y - by )*ts + ( x0 - bx )] );
+                }
+            });
+
+            const TileStore::Record * r = storeFind( tx, ty );
+
+            if ( !m_store.dir().empty() && !( r && r->x <= e->x && r->x + r->w >= e->x + e->w &&
+                 r->y <= e->y && r->y + r->h >= e->y + e->h ))
+            {
+                rec.key = key;
+                rec.delta = e->delta;
+                rec.cx = e->cx;
+                rec.cy = e->cy;
+                rec.x = e->x;
+                rec.y = e->y;
+                rec.w = e->w;
+                rec.h = e->h;
+                m_store.append( rec, &e->data[e->y*ts + e->x], ts );
+            }
+        }
+    }
+
+    if ( !m_store.dir().empty() )
+    {
+        m_store.flush();
+    }
+}
+
+/**
+ * @brief Processes a tile using Mariani-Silver subdivision
+ * @param a_tile - Tile to process
+ * @param a_px - Pixel list buffer
+ * @param a_stats - Kernel metrics (added to calculation totals before the tile completes)
+ *
+ * The border of the tile is calculated and, if uniform, the interior of the
+ * tile is filled with the border value. Otherwise the interior is split into
+ * (up to) four sub-tiles; all but one are queued for any worker to process, and
+ * the remaining sub-tile is processed by the calling worker. Small tiles are
+ * calculated directly. The pending tile count is decremented when a tile is
+ * fully resolved, and the control thread is notified when it reaches zero.
+ */
+void
+MandelbrotCalc::subdivideTile( Tile a_tile, vector<uint32_t> & a_px, KernelStats & a_stats )
+{
+    uint32_t    x, y, x2, y2, cnt, val;
+    bool        uniform;
+
+    while ( !m_cancel )
+    {
+        x2 = a_tile.x + a_tile.w - 1;
+        y2 = a_tile.y + a_tile.h - 1;
+        cnt = 0;
+
+        if ( a_tile.w <= MS_TILE_MIN || a_tile.h <= MS_TILE_MIN )
+        {
+            // Calculate all pixels in tile
+            a_px.resize( a_tile.w * a_tile.h );
+            for ( y = a_tile.y; y <= y2; y++ )
+            {
+                for ( x = a_tile.x; x <= x2; x++ )
+                {
+                    a_px[cnt++] = ( y << 16 ) | x;
+                }
+            }
+
+            (this->*tileKernel())( &a_px[0], cnt, a_stats );
+            a_stats.samples += cnt;
+            updateProgress( cnt );
+            break;
+        }
+
+        // Calculate tile border
+        a_px.resize( 2*( a_tile.w + a_tile.h ));
+        for ( x = a_tile.x; x <= x2; x++ )
+        {
+            a_px[cnt++] = ( a_tile.y << 16 ) | x;
+            a_px[cnt++] = ( y2 << 16 ) | x;
+        }
+
+        for ( y = a_tile.y + 1; y < y2; y++ )
+        {
+            a_px[cnt++] = ( y << 16 ) | a_tile.x;
+            a_px[cnt++] = ( y << 16 ) | x2;
+        }
+
+        (this->*tileKernel())( &a_px[0], cnt, a_stats );
+        a_stats.samples += cnt;
+
+        // Check if border is uniform
+        val = (*m_data)[(size_t)a_tile.y*m_w + a_tile.x];
+        uniform = true;
+        for ( uint32_t i = 0; i < cnt; i++ )
+        {
+            if ( (*m_data)[(size_t)( a_px[i] >> 16 )*m_w + ( a_px[i] & 0xFFFF )] != val )
+            {
+                uniform = false;
+                break;
+            }
+        }
+
+        if ( uniform )
+        {
+            // Fill interior with border value
+            m_data->visit( [&]( auto * a_data )
+            {
+                for ( y = a_tile.y + 1; y < y2; y++ )
+                {
+                    auto * row = a_data + (size_t)y*m_w;
+                    fill( row + a_tile.x + 1, row + x2, val );
+                }
+            });
+
+            cnt = a_tile.w*a_tile.h - cnt;
+            atomic_fetch_add( &m_filled_cnt, (uint64_t)cnt );
+            updateProgress( a_tile.w*a_tile.h );
+            break;
+        }
+
+        updateProgress( cnt );
+
+        // Split interior into four sub-tiles, queue three and continue with the last
+        Tile    sub[4];
+        uint16_t w1 = ( a_tile.w - 2 )/2, h1 = ( a_tile.h - 2 )/2;
+
+        sub[0] = { (uint16_t)( a_tile.x + 1 ), (uint16_t)( a_tile.y + 1 ), w1, h1 };
+        sub[1] = { (uint16_t)( a_tile.x + 1 + w1 ), (uint16_t)( a_tile.y + 1 ), (uint16_t)( a_tile.w - 2 - w1 ), h1 };
+        sub[2] = { (uint16_t)( a_tile.x + 1 ), (uint16_t)( a_tile.y + 1 + h1 ), w1, (uint16_t)( a_tile.h - 2 - h1 )};
+        sub[3] = { (uint16_t)( a_tile.x + 1 + w1 ), (uint16_t)( a_tile.y + 1 + h1 ), (uint16_t)( a_tile.w - 2 - w1 ), (uint16_t)( a_tile.h - 2 - h1 )};
+
+        // Pending count must be increased before tiles are visible to other workers
+        atomic_fetch_add( &m_tiles_pending, 3 );
+
+        {
+            lock_guard tile_lock( m_tile_mutex );
+            m_tiles.insert( m_tiles.end(), sub, sub + 3 );
+        }
+
+        a_tile = sub[3];
+    }
+
+    // Metrics are added before the tile completes, as the next calculation may start once all tiles are done
+    addKernelStats( a_stats );
+
+    if ( atomic_fetch_sub( &m_tiles_pending, 1 ) == 1 )
+    {
+        // All tiles completed, wake control thread
+        notifyCompleted();
+    }
+}
+
+/**
+ * @brief Wakes control thread when all work has been completed
+ *
+ * Taking the control mutex ensures the control thread is waiting on its cvar. The
+ * control thread may instead have seen the work complete (or been cancelled) and then
+ * hold the mutex while stopping workers or running the next calculation, thus the mutex
+ * is only tried while the control thread is still waiting.
+ */
+void
+MandelbrotCalc::notifyCompleted()
+{
+    unique_lock ctrl_lock( m_control_mutex, defer_lock );
+
+    while ( !ctrl_lock.try_lock() )
+    {
+        if ( !atomic_load( &m_ctrl_waiting ))
+            return;
+
+        this_thread::yield();
+    }
+
+    m_control_cvar.notify_all();
+}
+
+/**
+ * @brief Updates completed pixel count and notifies observer of progress changes
+ * @param a_px - Number of pixels completed
+ */
+void
+MandelbrotCalc::updateProgress( uint64_t a_px )
+{
+    int32_t     prog = ( atomic_fetch_add( &m_px_done, a_px ) + a_px )*100/m_px_total;
+    int32_t     last = atomic_load( &m_prog );
+
+    // Only the worker that advances the progress value notifies the observer
+    while ( prog > last )
+    {
+        if ( atomic_compare_exchange_weak( &m_prog, &last, prog ))
+        {
+            if ( prog < 100 )
+                m_observer->cbCalcProgress( prog );
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Adds worker kernel metrics to calculation totals
+ * @param a_stats - Kernel metrics to add
+ */
+void
+MandelbrotCalc::addKernelStats( KernelStats & a_stats )
+{
+    atomic_fetch_add( &m_interior_cnt, a_stats.interior );
+    atomic_fetch_add( &m_periodic_cnt, a_stats.periodic );
+    atomic_fetch_add( &m_rebase_cnt, a_stats.rebased );
+    atomic_fetch_add( &m_recheck_cnt, a_stats.rechecked );
+    atomic_fetch_add( &m_sample_cnt, a_stats.samples );
+}
+
+/**
+ * @brief Calculates the high-precision reference orbit used by the perturbation kernel
+ * @param a_result - Calculation result (provides origin and bounding point)
+ * @param a_ref_x - Reference pixel x coordinate
+ * @param a_ref_y - Reference pixel y coordinate
+ * @return False if calculation was cancelled; true otherwise
+ *
+ * The reference point is computed with enough precision to resolve pixel spacing,
+ * and the orbit is iterated (from Z = 0) until it escapes or reaches the max
+ * iteration count. Orbit values are stored as doubles in m_ref_x and m_ref_y.
+ */
+bool
+MandelbrotCalc::calcReferenceOrbit( const Result & a_result, uint16_t a_ref_x, uint16_t a_ref_y )
+{
+    uint16_t    limbs = HPReal::limbsForBits( (int32_t)-log2( m_delta ) + PERTURB_EXTRA_BITS );
+    HPReal      cx = HPReal( m_x1 + a_ref_x*m_delta, limbs );
+    HPReal      cy = HPReal( m_y1 + a_ref_y*m_delta, limbs );
+    HPReal      zx( limbs ), zy( limbs ), zx2( limbs ), zy2( limbs );
+    double      dx = 0, dy = 0;
+
+    if ( a_result.x0.size() )
+        cx = cx + HPReal( a_result.x0, limbs );
+
+    if ( a_result.y0.size() )
+        cy = cy + HPReal( a_result.y0, limbs );
+
+    m_ref_x.resize( 1 );
+    m_ref_y.resize( 1 );
+    m_ref_x[0] = m_ref_y[0] = 0;
+
+    // Note: Z_0 = 0 is stored, thus Z_i is at index i
+    for ( uint32_t i = 1; i <= m_mxi && dx*dx + dy*dy < 4; i++ )
+    {
+        if (( i & 0x3FF ) == 0 && m_cancel )
+            return false;
+
+        zy = ( zx + zx )*zy + cy;
+        zx = zx2 - zy2 + cx;
+        zx2 = zx*zx;
+        zy2 = zy*zy;
+
+        dx = zx.toDouble();
+        dy = zy.toDouble();
+        m_ref_x.push_back( dx );
+        m_ref_y.push_back( dy );
+    }
+
+    return true;
+}
@@ -7,6 +7,13 @@
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
+#include <string>
+#include <complex>
+#include "cpufeatures.h"
+#include "doubledouble.h"
+#include "iterbuffer.h"
+#include "tilecache.h"
+#include "tilestore.h"
 
 /**
  * @brief The MandelbrotCalc class implements parallel calculation of the Mandelbrot set
@@ -16,8 +23,14 @@
  * unless required by calculation parameter changes.
  *
  * The concurrency approach utilizes lock-free atomics to minimize thread contention.
- * Available work is assessed independently by worker threads and consists of individual
- * image lines (y-axis). This avoids memory contention and is simple to implement.
+ * Available work is assessed independently by worker threads and consists of square
+ * image tiles (size configurable or chosen from image size and thread count). Before
+ * work starts, the center pixel of each tile is calculated with a low iteration limit
+ * to estimate its cost, and tiles are processed from most to least expensive so that
+ * no worker is left with a long running tile at the end of the calculation. Tiles are
+ * dealt round-robin to per-worker queues; a worker takes tiles from the front of its
+ * own queue and, once it is empty, steals from the back of the queue of a randomly
+ * chosen worker. Queues are cache line aligned so that workers do not contend.
  *
  * If a worker thread pool is utilized, the pool is maintained across multiple
  * calculation calls, and it's size is adjusted as needed based in calculation
@@ -25,21 +38,123 @@
  *
  * The calculated image is a buffer containing iteration counts per pixel (i.e.
  * not a rendered image for display).
+ *
+ * Pixels are computed by a "kernel" method that is selected at startup based on
+ * CPU capabilities. Vectorized kernels (AVX2, AVX-512) iterate several pixels in
+ * lockstep and refill vector lanes with new pixels as they escape; a scalar kernel
+ * is used as a fallback. All kernels produce identical iteration counts.
+ *
+ * Kernels skip iteration of points that can be shown to be in the set: the main
+ * cardioid and period-2 bulb are checked analytically, and, if enabled, orbit
+ * periodicity detection (Brent's method) stops iterating once an orbit repeats.
+ *
+ * Optionally, Mariani-Silver subdivision may be used: the image is divided into
+ * rectangular tiles, and the border of each tile is calculated. Because the
+ * Mandelbrot set is connected, a tile with a uniform border can be filled with
+ * the border value; otherwise the tile is split into four and each is processed
+ * the same way. Tiles are held in a shared queue serviced by the worker pool.
+ * Note that features thinner than a pixel may be missed by this method.
+ *
+ * In progressive mode (not supported with subdivision), the image is calculated in
+ * passes: first a sparse lattice of pixels, then the remaining pixels of lattices
+ * with half the spacing, until all pixels are calculated. Each pixel is calculated
+ * once. After each pass, a partial image is filled from the pixels calculated so far
+ * and handed to the observer (moved) as a partial result.
+ *
+ * When the pixels of a calculation coincide with pixels of the previous one (i.e. the
+ * image is panned by whole pixels, or zoomed by an integer factor), the coinciding
+ * pixels are copied from the previous image and only the others are calculated (double
+ * and float kernels).
+ *
+ * Supersampled images (ss x ss samples per pixel) are calculated as an image of all
+ * samples. Optionally (reduced supersampling), factors above 2 are calculated in bands of
+ * pixels, with two bounded band buffers of samples: while the workers calculate a band,
+ * the control thread reduces the samples of the previous band to a 2 x 2 quantile summary
+ * per pixel (see reduceBand). Memory use thus does not grow with the factor, but colors
+ * are approximate.
+ *
+ * With adaptive supersampling, a base pass first calculates one sample per pixel. Pixels
+ * whose count differs from a neighbor are marked as having detail, and the bands then only
+ * calculate the other samples of these pixels, with sample columns and lines jittered
+ * within their strata. Flat regions (most of a typical image) thus cost one sample per pixel.
+ * The samples of each band are copied to the image (or reduced, as above).
+ *
+ * Calculated tiles (see TileCache) of recent images are kept in a memory bounded cache
+ * (double and float kernels). Before any work is scheduled, the parts of the image that
+ * coincide with cached tiles (i.e. revisited regions) are filled from the cache.
+ * If a store directory is given, tiles are also kept in a persistent store (see
+ * TileStore) that is read for tiles not in the memory cache, thus across sessions.
+ *
+ * Optionally, the final orbit value (z) of pixels that did not escape is kept with the
+ * result. If the same view is then calculated with a higher iteration limit, only these
+ * pixels are iterated further (from the previous limit); with a lower limit, the image
+ * is derived from the previous image without calculation. Orbits are kept as a list
+ * sorted by pixel, and only for pixels that may still escape (not periodic), thus
+ * memory use is proportional to the unresolved pixels rather than to the image.
+ *
+ * For shallow views, where single precision resolves pixel spacing, vectorized
+ * float kernels (with twice the lanes of the double kernels) may be requested. Pixels
+ * whose float results may differ from double precision are recalculated in double.
+ * Float kernels are only selected automatically for wide views with low iteration
+ * limits, and are replaced by the double kernel for the remaining tiles while the share
+ * of recalculated pixels is high (float is slower than double otherwise).
+ *
+ * For deep zooms, where pixel spacing approaches the precision of a double, a
+ * perturbation kernel is used (or, for very small images, a double-double kernel
+ * which avoids the cost of the reference orbit). A single high-precision reference orbit is
+ * calculated at the center of the image, and each pixel is iterated as a double
+ * delta from that orbit. To support such zooms, coordinates may be given relative
+ * to a high-precision origin (decimal strings); the bounding points are then
+ * offsets from the origin.
+ *
+ * At deep zooms, pixels share most of their orbit with the reference. A cubic
+ * series approximation (in the pixel offset) of the perturbation delta is used to
+ * skip the iterations for which its truncation error is below a fraction of pixel
+ * spacing, after which each pixel continues with the perturbation kernel.
  */
 class MandelbrotCalc
 {
 public:
+    /**
+     * @brief The KernelType enum identifies the arithmetic used to calculate pixels
+     */
+    enum KernelType : uint8_t
+    {
+        KT_AUTO = 0,    // Select automatically from pixel spacing (parameter only)
+        KT_FLOAT,       // Single precision (vectorized, with double precision recheck)
+        KT_DOUBLE,      // Double precision
+        KT_DOUBLE_DOUBLE, // Double-double precision (~106 bits)
+        KT_PERTURB      // Perturbation from high-precision reference orbit
+    };
+
     /**
      * @brief The CalcParams class contains required calculation parameters
      */
     struct Params{
-        uint16_t            res;        // Image resolution in pixels on major axis
+        uint16_t            res;        // Image resolution in pixels on major axis (includes supersampling)
+        std::string         x0;         // x coordinate of high-precision origin (decimal, empty = 0)
+        std::string         y0;         // y coordinate of high-precision origin (decimal, empty = 0)
         double              x1;         // x coordinate bounding point 1
         double              y1;         // y coordinate bounding point 1
         double              x2;         // x coordinate bounding point 2
         double              y2;         // y coordinate bounding point 2
         uint32_t            iter_mx;    // Max iterations
         uint16_t            th_cnt;     // Thread count
+        bool                simd = true; // Use vectorized kernel if supported by CPU
+        bool                periodicity = true; // Use orbit periodicity detection
+        bool                subdivide = false; // Use Mariani-Silver rectangle subdivision
+        KernelType          kernel = KT_AUTO; // Kernel type
+        bool                series = true; // Use series approximation to skip iterations (perturbation only)
+        uint16_t            tile_size = 0; // Work tile size in pixels (0 = auto)
+        bool                progressive = false; // Calculate in coarse to fine passes (partial results to observer)
+        bool                reuse = true; // Reuse coinciding pixels of previous result (pan or integer zoom)
+        bool                resume = false; // Keep orbits of unescaped pixels to continue when iter_mx is raised
+        uint32_t            cache_mb = 256; // Tile cache memory budget in MB (0 = disabled)
+        std::string         store_dir;  // Persistent tile store directory (empty = disabled, requires tile cache)
+        uint32_t            store_mb = 2048; // Persistent tile store size cap in MB
+        uint8_t             ss = 1;     // Supersampling factor (samples per pixel on each axis, see Result::ss)
+        bool                adaptive = false; // Supersample pixels with detail only (jittered samples, up to ss x ss)
+        bool                ss_reduce = false; // Reduce samples beyond a factor of 2 in bands (bounded memory, approximate)
     };
 
     /**
@@ -49,22 +164,43 @@ public:
         Result()
         {}
 
+        std::string             x0;         // x coordinate of high-precision origin
+        std::string             y0;         // y coordinate of high-precision origin
         double                  x1;         // x coordinate bounding point 1 (adjusted)
         double                  y1;         // y coordinate bounding point 1 (adjusted)
         double                  x2;         // x coordinate bounding point 2 (adjusted)
         double                  y2;         // y coordinate bounding point 2 (adjusted)
         uint32_t                iter_mx;    // Max iterations
         uint16_t                th_cnt;     // Thread count used
-        uint16_t                img_width;  // Image width
-        uint16_t                img_height; // Imahe height
-        std::vector<uint32_t>   img_data;   // Image data (internal buffer)
+        uint16_t                img_width;  // Image width (includes supersampling)
+        uint16_t                img_height; // Imahe height (includes supersampling)
+        IterBuffer              img_data;   // Image data (16-bit if iter_mx < 65535, see IterBuffer)
+        uint8_t                 ss;         // Supersampling factor of image data (ss x ss counts per pixel)
         uint64_t                time_ms;    // Calc time in milliseconds
+        CpuFeatures::SimdLevel  simd;       // SIMD level of kernel used
+        KernelType              kernel;     // Kernel type used
+        uint64_t                interior_cnt; // Pixels short-circuited by cardioid/bulb check
+        uint64_t                periodic_cnt; // Pixels stopped by periodicity detection
+        uint64_t                filled_cnt; // Pixels filled (not calculated) by subdivision
+        uint64_t                rebase_cnt; // Perturbation glitch corrections (re-referencing)
+        uint32_t                skip_iter;  // Iterations skipped (per pixel) by series approximation
+        uint64_t                recheck_cnt; // Pixels recalculated in double by float kernel
+        uint64_t                sample_cnt; // Samples calculated (excludes reused, cached, and filled pixels)
+        uint16_t                tile_size;  // Work tile size used (initial tile size if subdivision)
+        std::vector<uint32_t>   th_exec;    // Work tiles executed per thread (empty if subdivision)
+        std::vector<uint32_t>   th_stolen;  // Work tiles stolen from other threads per thread (empty if subdivision)
+        uint64_t                reused_cnt; // Pixels copied from previous result or tile cache
+        uint64_t                resumed_cnt; // Pixels continued from iteration limit of previous result
+        uint32_t                cache_hit_cnt; // Tiles (parts of image) filled from tile cache
+        uint32_t                cache_miss_cnt; // Tiles (parts of image) not found in tile cache
+        uint32_t                store_hit_cnt; // Tile cache hits read from persistent tile store
     };
 
     class IObserver
     {
     public:
         virtual void cbCalcProgress( int ) = 0;
+        virtual void cbCalcPartial( Result ) = 0;
         virtual void cbCalcCompleted( Result ) = 0;
         virtual void cbCalcCancelled() = 0;
     };
@@ -79,6 +215,54 @@ public:
     void        stopWorkerThreads();
 
 private:
+    /**
+     * @brief The KernelStats struct accumulates per-worker kernel metrics
+     */
+    struct KernelStats
+    {
+        uint64_t    interior;   // Pixels short-circuited by cardioid/bulb check
+        uint64_t    periodic;   // Pixels stopped by periodicity detection
+        uint64_t    rebased;    // Perturbation glitch corrections
+        uint64_t    rechecked;  // Pixels recalculated in double by float kernel
+        uint64_t    samples;    // Pixels (samples) calculated
+    };
+
+    /**
+     * @brief The KeptOrbit struct holds the final z of a pixel that did not escape (resume mode)
+     */
+    struct KeptOrbit
+    {
+        size_t                  idx;    // Pixel index
+        std::complex<double>    z;      // Final z
+    };
+
+    /**
+     * @brief Kernel method type - computes a list of pixels given as packed (x | y << 16) coordinates
+     */
+    typedef void (MandelbrotCalc::*Kernel)( const uint32_t * a_px, uint32_t a_cnt, KernelStats & a_stats );
+
+    /**
+     * @brief The Tile struct defines a rectangular region of the image (pixels)
+     */
+    struct Tile
+    {
+        uint16_t    x;          // Left column
+        uint16_t    y;          // Bottom line
+        uint16_t    w;          // Width
+        uint16_t    h;          // Height
+    };
+
+    /**
+     * @brief The WorkerQueue struct holds the work tiles of one worker (cache line aligned)
+     */
+    struct alignas(64) WorkerQueue
+    {
+        std::atomic<uint64_t>   range;      // Remaining positions in m_order (begin | end << 32)
+        uint32_t                executed;   // Work tiles executed by worker
+        uint32_t                stolen;     // Work tiles stolen by worker
+        uint32_t                seed;       // Random victim selection state
+    };
+
     std::thread*                m_control_thread;   // Control thread to manage workers
     std::mutex                  m_control_mutex;    // Mutex used to protect control thread cvar
     std::condition_variable     m_control_cvar;     // Cvar used to signal control thread to start
@@ -89,21 +273,144 @@ private:
     std::vector<std::thread*>   m_workers;          // Worker thread container
     std::mutex                  m_worker_mutex;     // Mutex used to protect worker cvar
     std::condition_variable     m_worker_cvar;      // Cvar used to signal workers
-    std::atomic<int32_t>        m_y_cur;            // Current image line to process (negative means no work)
-    std::atomic<int32_t>        m_y_done;           // Completed image lines
-    int32_t                     m_y_upd;
-    uint32_t *                  m_data;             // Image buffer
+    std::vector<Tile>           m_grid;             // Work tiles, least to most expensive (non-subdivision mode)
+    std::vector<uint32_t>       m_order;            // Work tile indices, by queue (most expensive first)
+    std::vector<WorkerQueue>    m_queues;           // Work tile queue per worker
+    uint32_t                    m_grid_gen;         // Work tile generation (protected by worker mutex)
+    std::atomic<int32_t>        m_grid_active;      // Workers processing work tiles
+    uint16_t                    m_pass_step;        // Pixel spacing of current progressive pass (1 = all pixels)
+    uint16_t                    m_skip;             // Spacing of lattice of pixels not calculated (0 = none)
+    Tile                        m_skip_rect;        // Bounds of lattice of pixels not calculated (origin at x,y)
+    alignas(64) std::atomic<int32_t> m_grid_pending; // Work tiles not yet completed
+    std::atomic<uint64_t>       m_interior_cnt;     // Pixels short-circuited by cardioid/bulb check
+    std::atomic<uint64_t>       m_periodic_cnt;     // Pixels stopped by periodicity detection
+    std::mutex                  m_tile_mutex;       // Mutex used to protect tile queue
+    std::vector<Tile>           m_tiles;            // Tile queue (subdivision mode)
+    std::atomic<int32_t>        m_tiles_pending;    // Tiles queued or in progress
+    std::atomic<uint64_t>       m_filled_cnt;       // Pixels filled by subdivision
+    std::atomic<uint64_t>       m_rebase_cnt;       // Perturbation glitch corrections
+    std::atomic<uint64_t>       m_recheck_cnt;      // Pixels recalculated in double by float kernel
+    std::atomic<uint64_t>       m_sample_cnt;       // Samples calculated
+    std::atomic<uint64_t>       m_px_done;          // Pixels completed (progress)
+    std::atomic<int32_t>        m_prog;             // Last reported progress
+    uint64_t                    m_px_total;         // Pixels to calculate (progress)
+    IterBuffer *                m_data;             // Image buffer (of current result)
     uint32_t                    m_mxi;              // Max iterations
     uint16_t                    m_w;                // Image width
     uint16_t                    m_h;                // Image height
     double                      m_x1;               // Initial X value
     double                      m_y1;               // Initial Y value
     double                      m_delta;            // Real delta between pixels
+    double                      m_per_tol;          // Periodicity detection tolerance (0 = disabled)
+    std::vector<double>         m_cx;               // Real coordinate of each image column
+    std::vector<double>         m_cy;               // Imaginary coordinate of each image line
+    std::vector<float>          m_cx_f;             // Real coordinate of each image column (float)
+    std::vector<float>          m_cy_f;             // Imaginary coordinate of each image line (float)
+    std::vector<DoubleDouble>   m_cx_dd;            // Real coordinate of each image column (double-double)
+    std::vector<DoubleDouble>   m_cy_dd;            // Imaginary coordinate of each image line (double-double)
+    std::vector<double>         m_ref_x;            // Reference orbit, real part (perturbation)
+    std::vector<double>         m_ref_y;            // Reference orbit, imaginary part (perturbation)
+    uint32_t                    m_sa_iter;          // Iterations skipped by series approximation
+    std::complex<double>        m_sa_a;             // Series approximation coefficients (dz = A.dc + B.dc^2 + C.dc^3)
+    std::complex<double>        m_sa_b;
+    std::complex<double>        m_sa_c;
+    CpuFeatures::SimdLevel      m_simd_level;       // SIMD level supported by CPU
+    Kernel                      m_kernel;           // Kernel used by current calculation
+    Kernel                      m_float_fallback;   // Double kernel replacing automatically selected float kernel (see tileKernel)
+    Result                      m_prev;             // Previous result (for reuse, empty image if none)
+    bool                        m_prev_periodicity; // Periodicity option of previous result
+    double                      m_prev_delta;       // Pixel spacing of previous result
+    std::vector<double>         m_prev_cx;          // Real coordinate of each column of previous result
+    std::vector<double>         m_prev_cy;          // Imaginary coordinate of each line of previous result
+    std::vector<int32_t>        m_reuse_x;          // Previous column of each image column (-1 if none)
+    std::vector<int32_t>        m_reuse_y;          // Previous line of each image line (-1 if none)
+    std::vector<KeptOrbit>      m_orbits;           // Orbits kept by kernels (resume mode, sorted by pixel once complete)
+    std::vector<KeptOrbit>      m_prev_orbit;       // Orbits kept for previous result (sorted, empty if none)
+    std::vector<KeptOrbit>      m_resume_orbit;     // Orbits continued by current calculation (sorted)
+    std::mutex                  m_orbit_mutex;      // Mutex used to protect kept orbits
+    bool                        m_keep_orbit;       // Kernels keep orbits of pixels that may still escape
+    bool                        m_prev_kept;        // Orbits were kept for previous result
+    uint32_t                    m_resume_iter;      // Iteration limit of continued orbits (0 = not resuming)
+    uint8_t                     m_ss;               // Supersampling factor calculated in bands (1 = none)
+    uint16_t                    m_ss_w;             // Image width in pixels (bands)
+    uint16_t                    m_ss_h;             // Image height in pixels (bands)
+    Tile                        m_band;             // Current band, in image pixels (width 0 = none)
+    IterBuffer                  m_band_data;        // Samples of current band (written by kernels)
+    IterBuffer                  m_band_done;        // Samples of completed band (being reduced)
+    uint32_t                    m_keep;             // Samples per axis kept for each pixel of band (see reduceBand)
+    bool                        m_adaptive;         // Adaptive supersampling (see markDetail)
+    bool                        m_adapt_band;       // Current band only calculates samples of pixels with detail
+    IterBuffer                  m_base;             // Base sample of each pixel (adaptive)
+    std::vector<uint8_t>        m_detail;           // Pixel has detail flags (adaptive)
+    std::vector<double>         m_jit_x;            // Jitter of each sample column of image (adaptive, 0 otherwise)
+    std::vector<double>         m_jit_y;            // Jitter of each sample line of image (adaptive, 0 otherwise)
+    std::vector<double>         m_ss_cx;            // Real coordinate of each sample column of image (bands)
+    std::vector<double>         m_ss_cy;            // Imaginary coordinate of each sample line of image (bands)
+    std::vector<float>          m_ss_cx_f;          // Real coordinate of each sample column of image (bands, float)
+    std::vector<float>          m_ss_cy_f;          // Imaginary coordinate of each sample line of image (bands, float)
+    std::vector<DoubleDouble>   m_ss_cx_dd;         // Real coordinate of each sample column of image (bands, double-double)
+    std::vector<DoubleDouble>   m_ss_cy_dd;         // Imaginary coordinate of each sample line of image (bands, double-double)
+    TileCache                   m_cache;            // Tiles of recent images
+    TileCache::Key              m_lat_key;          // Tile key of image lattice (tile position not set)
+    int64_t                     m_lat_x;            // Lattice column of image column 0
+    int64_t                     m_lat_y;            // Lattice line of image line 0
+    double                      m_lat_cx;           // Real coordinate of image column 0
+    double                      m_lat_cy;           // Imaginary coordinate of image line 0
+    TileStore                   m_store;            // Persistent tiles (open if store directory given)
     bool                        m_cancel;
+    std::atomic<bool>           m_ctrl_waiting;     // Control thread is waiting for work to complete
     bool                        m_exit;
 
     void controlThread();
     void workerThread( uint16_t id );
+    void buildGrid( uint16_t a_tile_size, const std::vector<Tile> & a_rects );
+    void dealGrid( uint16_t a_queue_cnt );
+    int32_t takeTile( WorkerQueue & a_queue, bool a_steal );
+    void processGrid( uint16_t a_id, std::vector<uint32_t> & a_px, KernelStats & a_stats );
+    void calcTile( const Tile & a_tile, std::vector<uint32_t> & a_px, KernelStats & a_stats );
+    Kernel tileKernel();
+    void fillPass( IterBuffer & a_dst );
+    void queueWork( Result & a_result, const std::vector<Tile> & a_rects, uint64_t a_px );
+    bool nextBand( Result & a_result );
+    void setSampleCoords( KernelType a_kernel, uint32_t a_x, uint32_t a_y, uint32_t a_step );
+    uint64_t markDetail();
+    bool sampled( uint32_t a_x, uint32_t a_y ) const;
+    void reduceBand( Result & a_result, const Tile & a_band );
+    bool checkReuse( const Result & a_result );
+    void mapAxis( std::vector<int32_t> & a_map, uint16_t a_cnt, uint16_t a_prev_cnt, uint32_t a_num, uint32_t a_den, int64_t a_off );
+    uint64_t reuseRegions( std::vector<Tile> & a_rects );
+    void reuseImage();
+    bool checkResume( const Result & a_result );
+    void deriveImage( Result & a_result );
+    bool resumable( size_t a_idx ) const;
+    static const KeptOrbit * findOrbit( const std::vector<KeptOrbit> & a_orbits, size_t a_idx );
+    void keepOrbits( const std::vector<KeptOrbit> & a_kept );
+    void cacheLattice( const Result & a_result, double a_ox, double a_oy );
+    bool cacheMatch( double a_delta, double a_cx, double a_cy, int64_t a_tx, int64_t a_ty ) const;
+    TileCache::Entry * cacheFind( int64_t a_tx, int64_t a_ty );
+    const TileStore::Record * storeFind( int64_t a_tx, int64_t a_ty );
+    uint64_t cacheFill( std::vector<Tile> & a_rects, Result & a_result );
+    void cacheStore();
+    void subdivideTile( Tile a_tile, std::vector<uint32_t> & a_px, KernelStats & a_stats );
+    void updateProgress( uint64_t a_px );
+    void notifyCompleted();
+    void addKernelStats( KernelStats & a_stats );
+    bool calcReferenceOrbit( const Result & a_result, uint16_t a_ref_x, uint16_t a_ref_y );
+    void calcSeriesApprox();
+
+    // Kernels (see mandelbrotkernels.cpp and mandelbrotperturb.cpp)
+    void kernelScalar( const uint32_t * a_px, uint32_t a_cnt, KernelStats & a_stats );
+    void kernelDoubleDouble( const uint32_t * a_px, uint32_t a_cnt, KernelStats & a_stats );
+    void kernelPerturb( const uint32_t * a_px, uint32_t a_cnt, KernelStats & a_stats );
+    template<typename T>
+    void kernelScalarT( const T * a_cx, const T * a_cy, const uint32_t * a_px, uint32_t a_cnt, KernelStats & a_stats );
+#ifdef CPU_X86
+    void kernelAVX2( const uint32_t * a_px, uint32_t a_cnt, KernelStats & a_stats );
+    void kernelAVX512( const uint32_t * a_px, uint32_t a_cnt, KernelStats & a_stats );
+    void kernelFloatAVX2( const uint32_t * a_px, uint32_t a_cnt, KernelStats & a_stats );
+    void kernelFloatAVX512( const uint32_t * a_px, uint32_t a_cnt, KernelStats & a_stats );
+    void queueRecheck( uint32_t * a_redo, uint32_t & a_redo_cnt, uint32_t a_xy, Kernel a_kernel, KernelStats & a_stats );
+#endif
 };
 
 #endif // MANDELBROTCALC_H
@@ -0,0 +1,1017 @@
+#include <cmath>
+#include <algorithm>
+#include <type_traits>
+#include "mandelbrotcalc.h"
+
+// Bound on float rounding error (in z) introduced per iteration
+#define FLOAT_ERR 1e-6f
+
+// Size of float kernel recalculation list
+#define FLOAT_REDO_MAX 64
+
+// Max pixels queued for lane refill by float kernels
+#define FLOAT_QUEUE 64
+
+// Min periodicity detection tolerance of float kernels (~8 ulp of |z| near 1). Periodic pixels are
+// recalculated in double precision, thus this only stops float iteration of likely interior pixels.
+#define FLOAT_PER_TOL 1e-6f
+
+#ifdef CPU_X86
+#include <immintrin.h>
+#endif
+
+// NOTE: The vectorized kernels must produce exactly the same iteration counts as the
+// scalar kernel. This requires the same floating point operations, in the same order,
+// without fused multiply-add contraction (see -ffp-contract=off in project file).
+
+/**
+ * @brief Tests if a point lies within the main cardioid or the period-2 bulb
+ * @param a_x - Real coordinate
+ * @param a_y - Imaginary coordinate
+ * @return True if point is (analytically) in the Mandelbrot set
+ *
+ * Points in these regions never escape, thus they can be written as 0 without
+ * iterating to the max iteration count.
+ */
+template<typename T>
+static inline bool
+isInteriorPoint( const T & a_x, const T & a_y )
+{
+    T y2 = a_y*a_y;
+
+    // Period-2 bulb: circle of radius 1/4 centered at -1
+    T xp = a_x + 1;
+    if ( xp*xp + y2 < 0.0625 )
+        return true;
+
+    // Main cardioid
+    T xq = a_x - 0.25;
+    T q = xq*xq + y2;
+
+    return q*( q + xq ) < 0.25*y2;
+}
+
+/**
+ * @brief Returns the first periodicity save count at or above an iteration count
+ * @param a_iter - Iteration count at which kernel starts
+ * @return Save count (power of 2)
+ */
+static inline uint32_t
+firstSaveCount( uint32_t a_iter )
+{
+    uint32_t chk = 1;
+
+    while ( chk < a_iter )
+        chk <<= 1;
+
+    return chk;
+}
+
+/**
+ * @brief Scalar kernel - computes iteration counts for a list of pixels
+ * @param a_px - Packed pixel coordinates (x | y << 16)
+ * @param a_cnt - Number of pixels in list
+ * @param a_stats - Kernel metrics to update
+ */
+void
+MandelbrotCalc::kernelScalar( const uint32_t * a_px, uint32_t a_cnt, KernelStats & a_stats )
+{
+    kernelScalarT<double>( &m_cx[0], &m_cy[0], a_px, a_cnt, a_stats );
+}
+
+/**
+ * @brief Double-double kernel - computes iteration counts for a list of pixels
+ * @param a_px - Packed pixel coordinates (x | y << 16)
+ * @param a_cnt - Number of pixels in list
+ * @param a_stats - Kernel metrics to update
+ */
+void
+MandelbrotCalc::kernelDoubleDouble( const uint32_t * a_px, uint32_t a_cnt, KernelStats & a_stats )
+{
+    kernelScalarT<DoubleDouble>( &m_cx_dd[0], &m_cy_dd[0], a_px, a_cnt, a_stats );
+}
+
+/**
+ * @brief Generic scalar kernel - computes iteration counts for a list of pixels
+ * @param a_cx - Real coordinate of each image column
+ * @param a_cy - Imaginary coordinate of each image line
+ * @param a_px - Packed pixel coordinates (x | y << 16)
+ * @param a_cnt - Number of pixels in list
+ * @param a_stats - Kernel metrics to update
+ *
+ * The arithmetic type (T) must support +, -, * and < with doubles, and fabs(). Orbits
+ * are only kept and continued (resume mode) for doubles.
+ */
+template<typename T>
+void
+MandelbrotCalc::kernelScalarT( const T * a_cx, const T * a_cy, const uint32_t * a_px, uint32_t a_cnt, KernelStats & a_stats )
+{
+    const uint32_t *    end = a_px + a_cnt;
+    const uint32_t      mxi = m_mxi;
+    const double        tol = m_per_tol;
+    const uint32_t      chk0 = firstSaveCount( m_resume_iter );
+    uint16_t            x, y;
+    T                   xr, yr, zx, zy, zx2, zy2, tmp, sx, sy;
+    uint32_t            i, chk;
+    size_t              idx;
+    std::vector<KeptOrbit> kept;
+
+    for ( ; a_px != end; a_px++ )
+    {
+        if ( m_cancel )
+            break;
+
+        x = *a_px & 0xFFFF;
+        y = *a_px >> 16;
+        idx = (size_t)y*m_w + x;
+        xr = a_cx[x];
+        yr = a_cy[y];
+
+        if ( isInteriorPoint( xr, yr ))
+        {
+            m_data->set( idx, 0 );
+            a_stats.interior++;
+            continue;
+        }
+
+        // Perform calculation: Z => Z^2 + C, starting from z = C after the first iteration,
+        // or from the kept orbit after the previous iteration limit
+
+        i = m_resume_iter;
+        zx = xr;
+        zy = yr;
+
+        if ( m_resume_iter )
+        {
+            const KeptOrbit * o = findOrbit( m_resume_orbit, idx );
+
+            zx = o->z.real();
+            zy = o->z.imag();
+        }
+
+        zx2 = zx*zx;
+        zy2 = zy*zy;
+
+        if ( tol > 0 )
+        {
+            // Brent's cycle detection: z is saved after 1, 2, 4, 8... iterations and each
+            // subsequent value is compared to the saved value. A match within tolerance means
+            // the orbit is periodic (or converging), thus the point will never escape.
+            sx = sy = INFINITY;
+            chk = chk0;
+
+            while ( i++ < mxi && (( zx2 + zy2 ) < 4 ))
+            {
+                if ( fabs( zx - sx ) < tol && fabs( zy - sy ) < tol )
+                {
+                    // Periodic orbit is not kept (never escapes)
+                    a_stats.periodic++;
+                    zx = zy = NAN;
+                    i = mxi + 1;
+                    break;
+                }
+
+                if ( i - 1 == chk )
+                {
+                    sx = zx;
+                    sy = zy;
+                    chk <<= 1;
+                }
+
+                tmp = zx;
+                zx2 = zx = zx2 - zy2 + xr;
+                zy2 = zy = 2*tmp*zy + yr;
+                zx2 *= zx;
+                zy2 *= zy;
+            };
+
+            // z at the iteration limit is also tested for periodicity (unless escaped), as in the vector kernels
+            if ( i == mxi + 1 && ( zx2 + zy2 ) < 4 && fabs( zx - sx ) < tol && fabs( zy - sy ) < tol )
+            {
+                a_stats.periodic++;
+                zx = zy = NAN;
+            }
+        }
+        else
+        {
+            while ( i++ < mxi && (( zx2 + zy2 ) < 4 ))
+            {
+                tmp = zx;
+                zx2 = zx = zx2 - zy2 + xr;
+                zy2 = zy = 2*tmp*zy + yr;
+                zx2 *= zx;
+                zy2 *= zy;
+            };
+        }
+
+        // Note: z after the last iteration is not tested for escape, it is kept to continue from instead
+        if ( i > mxi )
+        {
+            i = 0;
+
+            if constexpr ( std::is_same<T,double>::value )
+            {
+                if ( m_keep_orbit && !std::isnan( zx ))
+                    kept.push_back({ idx, std::complex<double>( zx, zy )});
+            }
+        }
+
+        m_data->set( idx, i );
+    }
+
+    keepOrbits( kept );
+}
+
+#ifdef CPU_X86
+
+/**
+ * @brief AVX2 kernel - computes iteration counts for a list of pixels, 4 at a time
+ * @param a_px - Packed pixel coordinates (x | y << 16)
+ * @param a_cnt - Number of pixels in list
+ * @param a_stats - Kernel metrics to update
+ *
+ * Each vector lane iterates a different pixel. The iteration count of each lane
+ * is tracked independently, and when any lane escapes (or reaches max iterations)
+ * its result is written and the lane is refilled with the next pixel from the list.
+ * Idle lanes (list exhausted) are parked with z = 0 and a count that never completes.
+ * Pixels inside the cardioid or period-2 bulb are resolved during refill and never
+ * occupy a lane. Periodicity detection state (saved z, next save count) is also
+ * kept per lane. When continuing orbits (resume mode), lanes are loaded with the kept
+ * orbit and the previous iteration limit instead of z = C and 0.
+ */
+CPU_TARGET_AVX2 void
+MandelbrotCalc::kernelAVX2( const uint32_t * a_px, uint32_t a_cnt, KernelStats & a_stats )
+{
+    const __m256d   v_four = _mm256_set1_pd( 4.0 );
+    const __m256d   v_one = _mm256_set1_pd( 1.0 );
+    const __m256d   v_mxi = _mm256_set1_pd( m_mxi );
+    const __m256d   v_tol = _mm256_set1_pd( m_per_tol );
+    const __m256d   v_abs = _mm256_castsi256_pd( _mm256_set1_epi64x( 0x7FFFFFFFFFFFFFFF ));
+    const bool      per = m_per_tol > 0;
+    alignas(32) double cx[4], cy[4], zx[4], zy[4], n[4], sx[4], sy[4], chk[4];
+    const double    chk0 = firstSaveCount( m_resume_iter );
+    size_t          dst[4];
+    uint32_t        next = 0, val;
+    int             active = 0, l, done, esc, prd = 0;
+    std::vector<KeptOrbit> kept;
+
+    // Loads next (non-interior) pixel from list into lane, or parks lane if none left
+    // Note: lambda must share target attribute with kernel to avoid AVX/SSE transitions
+    auto refill = [&]( int a_lane ) CPU_TARGET_AVX2
+    {
+        sx[a_lane] = sy[a_lane] = INFINITY;
+        chk[a_lane] = chk0;
+
+        while ( next < a_cnt )
+        {
+            uint32_t xy = a_px[next++];
+            uint16_t x = xy & 0xFFFF, y = xy >> 16;
+
+            if ( isInteriorPoint( m_cx[x], m_cy[y] ))
+            {
+                m_data->set( (size_t)y*m_w + x, 0 );
+                a_stats.interior++;
+                continue;
+            }
+
+            zx[a_lane] = cx[a_lane] = m_cx[x];
+            zy[a_lane] = cy[a_lane] = m_cy[y];
+            n[a_lane] = m_resume_iter;
+            dst[a_lane] = (size_t)y*m_w + x;
+            active++;
+
+            if ( m_resume_iter )
+            {
+                const KeptOrbit * o = findOrbit( m_resume_orbit, dst[a_lane] );
+
+                zx[a_lane] = o->z.real();
+                zy[a_lane] = o->z.imag();
+            }
+            return;
+        }
+
+        zx[a_lane] = zy[a_lane] = cx[a_lane] = cy[a_lane] = 0;
+        n[a_lane] = -INFINITY;
+        dst[a_lane] = 0;
+    };
+
+    for ( l = 0; l < 4; l++ )
+        refill( l );
+
+    __m256d v_cx = _mm256_load_pd( cx ), v_cy = _mm256_load_pd( cy );
+    __m256d v_zx = _mm256_load_pd( zx ), v_zy = _mm256_load_pd( zy );
+    __m256d v_n = _mm256_load_pd( n );
+    __m256d v_sx = _mm256_load_pd( sx ), v_sy = _mm256_load_pd( sy ), v_chk = _mm256_load_pd( chk );
+    __m256d v_zx2, v_zy2, v_esc, v_done, v_per, v_sav;
+
+    while ( active )
+    {
+        v_zx2 = _mm256_mul_pd( v_zx, v_zx );
+        v_zy2 = _mm256_mul_pd( v_zy, v_zy );
+
+        // Escaped if not (|z|^2 < 4) - this also catches NaN as in scalar kernel
+        v_esc = _mm256_cmp_pd( _mm256_add_pd( v_zx2, v_zy2 ), v_four, _CMP_NLT_UQ );
+        v_done = _mm256_or_pd( v_esc, _mm256_cmp_pd( v_n, v_mxi, _CMP_GE_OQ ));
+
+        if ( per )
+        {
+            // Periodic if z matches saved z (within tolerance)
+            v_per = _mm256_and_pd(
+                _mm256_cmp_pd( _mm256_and_pd( _mm256_sub_pd( v_zx, v_sx ), v_abs ), v_tol, _CMP_LT_OQ ),
+                _mm256_cmp_pd( _mm256_and_pd( _mm256_sub_pd( v_zy, v_sy ), v_abs ), v_tol, _CMP_LT_OQ ));
+            v_done = _mm256_or_pd( v_done, v_per );
+            prd = _mm256_movemask_pd( v_per );
+        }
+
+        done = _mm256_movemask_pd( v_done );
+
+        if ( done )
+        {
+            if ( m_cancel )
+                return;
+
+            esc = _mm256_movemask_pd( v_esc );
+
+            _mm256_store_pd( zx, v_zx );
+            _mm256_store_pd( zy, v_zy );
+            _mm256_store_pd( n, v_n );
+            _mm256_store_pd( sx, v_sx );
+            _mm256_store_pd( sy, v_sy );
+            _mm256_store_pd( chk, v_chk );
+
+            for ( l = 0; l < 4; l++ )
+            {
+                if ( done & ( 1 << l ))
+                {
+                    if ( esc & ( 1 << l ))
+                    {
+                        val = n[l] < m_mxi ? (uint32_t)n[l] + 1 : 0;
+                    }
+                    else
+                    {
+                        val = 0;
+                        if ( prd & ( 1 << l ))
+                            a_stats.periodic++;
+                    }
+
+                    m_data->set( dst[l], val );
+
+                    // Keep orbit of pixels that did not escape within limit (not periodic, which never escape)
+                    if ( m_keep_orbit && !val && !( prd & ~esc & ( 1 << l )))
+                    {
+                        kept.push_back({ dst[l], std::complex<double>( zx[l], zy[l] )});
+                    }
+
+                    active--;
+                    refill( l );
+                }
+            }
+
+            v_cx = _mm256_load_pd( cx );
+            v_cy = _mm256_load_pd( cy );
+            v_zx = _mm256_load_pd( zx );
+            v_zy = _mm256_load_pd( zy );
+            v_n = _mm256_load_pd( n );
+            v_sx = _mm256_load_pd( sx );
+            v_sy = _mm256_load_pd( sy );
+            v_chk = _mm256_load_pd( chk );
+
+            continue;
+        }
+
+        if ( per )
+        {
+            // Save z in lanes that reached their next save count, then double save count
+            v_sav = _mm256_cmp_pd( v_n, v_chk, _CMP_EQ_OQ );
+            v_sx = _mm256_blendv_pd( v_sx, v_zx, v_sav );
+            v_sy = _mm256_blendv_pd( v_sy, v_zy, v_sav );
+            v_chk = _mm256_blendv_pd( v_chk, _mm256_add_pd( v_chk, v_chk ), v_sav );
+        }
+
+        // Z => Z^2 + C (same operation order as scalar kernel)
+        v_zy = _mm256_add_pd( _mm256_mul_pd( _mm256_add_pd( v_zx, v_zx ), v_zy ), v_cy );
+        v_zx = _mm256_add_pd( _mm256_sub_pd( v_zx2, v_zy2 ), v_cx );
+        v_n = _mm256_add_pd( v_n, v_one );
+    }
+
+    keepOrbits( kept );
+}
+
+/**
+ * @brief AVX-512 kernel - computes iteration counts for a list of pixels, 8 at a time
+ * @param a_px - Packed pixel coordinates (x | y << 16)
+ * @param a_cnt - Number of pixels in list
+ * @param a_stats - Kernel metrics to update
+ *
+ * See kernelAVX2() for a description of lane management.
+ */
+CPU_TARGET_AVX512 void
+MandelbrotCalc::kernelAVX512( const uint32_t * a_px, uint32_t a_cnt, KernelStats & a_stats )
+{
+    const __m512d   v_four = _mm512_set1_pd( 4.0 );
+    const __m512d   v_one = _mm512_set1_pd( 1.0 );
+    const __m512d   v_mxi = _mm512_set1_pd( m_mxi );
+    const __m512d   v_tol = _mm512_set1_pd( m_per_tol );
+    const bool      per = m_per_tol > 0;
+    alignas(64) double cx[8], cy[8], zx[8], zy[8], n[8], sx[8], sy[8], chk[8];
+    const double    chk0 = firstSaveCount( m_resume_iter );
+    size_t          dst[8];
+    uint32_t        next = 0, val;
+    int             active = 0, l;
+    __mmask8        done, esc, prd = 0, sav;
+    std::vector<KeptOrbit> kept;
+
+    // Loads next (non-interior) pixel from list into lane, or parks lane if none left
+    // Note: lambda must share target attribute with kernel to avoid AVX/SSE transitions
+    auto refill = [&]( int a_lane ) CPU_TARGET_AVX512
+    {
+        sx[a_lane] = sy[a_lane] = INFINITY;
+        chk[a_lane] = chk0;
+
+        while ( next < a_cnt )
+        {
+            uint32_t xy = a_px[next++];
+            uint16_t x = xy & 0xFFFF, y = xy >> 16;
+
+            if ( isInteriorPoint( m_cx[x], m_cy[y] ))
+            {
+                m_data->set( (size_t)y*m_w + x, 0 );
+                a_stats.interior++;
+                continue;
+            }
+
+            zx[a_lane] = cx[a_lane] = m_cx[x];
+            zy[a_lane] = cy[a_lane] = m_cy[y];
+            n[a_lane] = m_resume_iter;
+            dst[a_lane] = (size_t)y*m_w + x;
+            active++;
+
+            if ( m_resume_iter )
+            {
+                const KeptOrbit * o = findOrbit( m_resume_orbit, dst[a_lane] );
+
+                zx[a_lane] = o->z.real();
+                zy[a_lane] = o->z.imag();
+            }
+            return;
+        }
+
+        zx[a_lane] = zy[a_lane] = cx[a_lane] = cy[a_lane] = 0;
+        n[a_lane] = -INFINITY;
+        dst[a_lane] = 0;
+    };
+
+    for ( l = 0; l < 8; l++ )
+        refill( l );
+
+    __m512d v_cx = _mm512_load_pd( cx ), v_cy = _mm512_load_pd( cy );
+    __m512d v_zx = _mm512_load_pd( zx ), v_zy = _mm512_load_pd( zy );
+    __m512d v_n = _mm512_load_pd( n );
+    __m512d v_sx = _mm512_load_pd( sx ), v_sy = _mm512_load_pd( sy ), v_chk = _mm512_load_pd( chk );
+    __m512d v_zx2, v_zy2;
+
+    while ( active )
+    {
+        v_zx2 = _mm512_mul_pd( v_zx, v_zx );
+        v_zy2 = _mm512_mul_pd( v_zy, v_zy );
+
+        // Escaped if not (|z|^2 < 4) - this also catches NaN as in scalar kernel
+        esc = _mm512_cmp_pd_mask( _mm512_add_pd( v_zx2, v_zy2 ), v_four, _CMP_NLT_UQ );
+        done = esc | _mm512_cmp_pd_mask( v_n, v_mxi, _CMP_GE_OQ );
+
+        if ( per )
+        {
+            // Periodic if z matches saved z (within tolerance)
+            prd = _mm512_cmp_pd_mask( _mm512_abs_pd( _mm512_sub_pd( v_zx, v_sx )), v_tol, _CMP_LT_OQ ) &
+                  _mm512_cmp_pd_mask( _mm512_abs_pd( _mm512_sub_pd( v_zy, v_sy )), v_tol, _CMP_LT_OQ );
+            done |= prd;
+        }
+
+        if ( done )
+        {
+            if ( m_cancel )
+                return;
+
+            _mm512_store_pd( zx, v_zx );
+            _mm512_store_pd( zy, v_zy );
+            _mm512_store_pd( n, v_n );
+            _mm512_store_pd( sx, v_sx );
+            _mm512_store_pd( sy, v_sy );
+            _mm512_store_pd( chk, v_chk );
+
+            for ( l = 0; l < 8; l++ )
+            {
+                if ( done & ( 1 << l ))
+                {
+                    if ( esc & ( 1 << l ))
+                    {
+                        val = n[l] < m_mxi ? (uint32_t)n[l] + 1 : 0;
+                    }
+                    else
+                    {
+                        val = 0;
+                        if ( prd & ( 1 << l ))
+                            a_stats.periodic++;
+                    }
+
+                    m_data->set( dst[l], val );
+
+                    // Keep orbit of pixels that did not escape within limit (not periodic, which never escape)
+                    if ( m_keep_orbit && !val && !( prd & ~esc & ( 1 << l )))
+                    {
+                        kept.push_back({ dst[l], std::complex<double>( zx[l], zy[l] )});
+                    }
+
+                    active--;
+                    refill( l );
+                }
+            }
+
+            v_cx = _mm512_load_pd( cx );
+            v_cy = _mm512_load_pd( cy );
+            v_zx = _mm512_load_pd( zx );
+            v_zy = _mm512_load_pd( zy );
+            v_n = _mm512_load_pd( n );
+            v_sx = _mm512_load_pd( sx );
+            v_sy = _mm512_load_pd( sy );
+            v_chk = _mm512_load_pd( chk );
+
+            continue;
+        }
+
+        if ( per )
+        {
+            // Save z in lanes that reached their next save count, then double save count
+            sav = _mm512_cmp_pd_mask( v_n, v_chk, _CMP_EQ_OQ );
+            v_sx = _mm512_mask_blend_pd( sav, v_sx, v_zx );
+            v_sy = _mm512_mask_blend_pd( sav, v_sy, v_zy );
+            v_chk = _mm512_mask_blend_pd( sav, v_chk, _mm512_add_pd( v_chk, v_chk ));
+        }
+
+        // Z => Z^2 + C (same operation order as scalar kernel)
+        v_zy = _mm512_add_pd( _mm512_mul_pd( _mm512_add_pd( v_zx, v_zx ), v_zy ), v_cy );
+        v_zx = _mm512_add_pd( _mm512_sub_pd( v_zx2, v_zy2 ), v_cx );
+        v_n = _mm512_add_pd( v_n, v_one );
+    }
+
+    keepOrbits( kept );
+}
+
+/**
+ * @brief Counts the set bits of a lane mask
+ * @param a_bits - Lane mask
+ * @return Number of set bits
+ */
+static inline uint32_t
+bitCount( uint32_t a_bits )
+{
+    a_bits = a_bits - (( a_bits >> 1 ) & 0x55555555 );
+    a_bits = ( a_bits & 0x33333333 ) + (( a_bits >> 2 ) & 0x33333333 );
+
+    return ((( a_bits + ( a_bits >> 4 )) & 0x0F0F0F0F )*0x01010101 ) >> 24;
+}
+
+/**
+ * @brief Returns the lowest set bits of a lane mask
+ * @param a_bits - Lane mask
+ * @param a_cnt - Number of bits to keep
+ * @return Mask of the a_cnt lowest set bits (all set bits if fewer)
+ */
+static inline uint32_t
+lowBits( uint32_t a_bits, uint32_t a_cnt )
+{
+    uint32_t res = 0;
+
+    for ( ; a_cnt && a_bits; a_cnt-- )
+    {
+        res |= a_bits & ( ~a_bits + 1 );
+        a_bits &= a_bits - 1;
+    }
+
+    return res;
+}
+
+/**
+ * @brief The FloatExpand struct holds the lane permutations that emulate expand loads with AVX2
+ *
+ * For each 8-lane mask, each lane of the mask takes the element at its rank among the lanes
+ * of the mask, thus consecutive values fill the lanes of the mask in order (as an AVX-512
+ * expand load does).
+ */
+struct FloatExpand
+{
+    alignas(32) int32_t idx[256][8];
+
+    constexpr FloatExpand():
+        idx{}
+    {
+        for ( int m = 0; m < 256; m++ )
+        {
+            int r = 0;
+
+            for ( int i = 0; i < 8; i++ )
+                idx[m][i] = ( m >> i ) & 1 ? r++ : 0;
+        }
+    }
+};
+
+static constexpr FloatExpand s_float_expand;
+
+/**
+ * @brief Queues a pixel to be recalculated in double precision (float kernels)
+ * @param a_redo - Recalculation list
+ * @param a_redo_cnt - Number of pixels in list
+ * @param a_xy - Packed pixel coordinate
+ * @param a_kernel - Double precision kernel used to process list when full
+ * @param a_stats - Kernel metrics to update
+ */
+void
+MandelbrotCalc::queueRecheck( uint32_t * a_redo, uint32_t & a_redo_cnt, uint32_t a_xy, Kernel a_kernel, KernelStats & a_stats )
+{
+    a_redo[a_redo_cnt++] = a_xy;
+
+    if ( a_redo_cnt == FLOAT_REDO_MAX )
+    {
+        (this->*a_kernel)( a_redo, a_redo_cnt, a_stats );
+        a_stats.rechecked += a_redo_cnt;
+        a_redo_cnt = 0;
+    }
+}
+
+/**
+ * @brief AVX2 float kernel - computes iteration counts for a list of pixels, 8 at a time
+ * @param a_px - Packed pixel coordinates (x | y << 16)
+ * @param a_cnt - Number of pixels in list
+ * @param a_stats - Kernel metrics to update
+ *
+ * Single precision version of kernelAVX2() with twice the number of lanes. Escapes of short
+ * orbits are frequent at the shallow zooms where float is used, thus lanes are refilled
+ * without scalar lane state: pixels are queued in packed arrays (interior points are resolved
+ * when queued), and the lanes that are done are refilled from the queue by an expand load
+ * (emulated by a permutation, see FloatExpand) of each state vector.
+ *
+ * Float results are only accepted for pixels that escape clear of the float error bound.
+ * Rounding errors are amplified by subsequent iterations in the same way as a change in c,
+ * thus the accumulated error in z is bounded by FLOAT_ERR.sqrt(D), where D is a running
+ * estimate of |dz/dc|^2 (D => 4|z|^2.D + 1). The count is exact (same as double precision)
+ * if z is further than this error from the bailout radius, both at escape and at the orbit
+ * point closest to escape before that. All other pixels (near the bailout radius, periodic,
+ * or reaching max iterations) are recalculated with the double precision kernel.
+ */
+CPU_TARGET_AVX2 void
+MandelbrotCalc::kernelFloatAVX2( const uint32_t * a_px, uint32_t a_cnt, KernelStats & a_stats )
+{
+    const __m256    v_zero = _mm256_setzero_ps();
+    const __m256    v_one = _mm256_set1_ps( 1.0f );
+    const __m256    v_two = _mm256_set1_ps( 2.0f );
+    const __m256    v_four = _mm256_set1_ps( 4.0f );
+    const __m256    v_inf = _mm256_set1_ps( INFINITY );
+    const __m256    v_park = _mm256_set1_ps( -INFINITY );
+    const __m256    v_err = _mm256_set1_ps( FLOAT_ERR );
+    const __m256    v_mxi = _mm256_set1_ps( m_mxi );
+    const __m256    v_tol = _mm256_set1_ps( std::max( (float)m_per_tol, FLOAT_PER_TOL ));
+    const __m256    v_abs = _mm256_castsi256_ps( _mm256_set1_epi32( 0x7FFFFFFF ));
+    const __m256i   v_bits = _mm256_setr_epi32( 1, 2, 4, 8, 16, 32, 64, 128 );
+    const bool      per = m_per_tol > 0;
+    alignas(32) float qx[FLOAT_QUEUE + 8] = {}, qy[FLOAT_QUEUE + 8] = {}, n[8];
+    alignas(32) uint32_t qp[FLOAT_QUEUE + 8] = {}, pix[8];
+    uint32_t        redo[FLOAT_REDO_MAX], redo_cnt = 0;
+    uint32_t        next = 0, qh = 0, qt = 0, cnt;
+    int             active = 0, l, fill = 0xFF, park, done, esc, ok;
+
+    // Moves the pixels left in queue to its front, and queues pixels from the list behind them
+    auto enqueue = [&]() CPU_TARGET_AVX2
+    {
+        for ( cnt = 0; qh < qt; qh++, cnt++ )
+        {
+            qx[cnt] = qx[qh];
+            qy[cnt] = qy[qh];
+            qp[cnt] = qp[qh];
+        }
+
+        qh = 0;
+        qt = cnt;
+
+        while ( qt < FLOAT_QUEUE && next < a_cnt )
+        {
+            uint32_t xy = a_px[next++];
+            uint16_t x = xy & 0xFFFF, y = xy >> 16;
+
+            if ( isInteriorPoint( m_cx[x], m_cy[y] ))
+            {
+                m_data->set( (size_t)y*m_w + x, 0 );
+                a_stats.interior++;
+                continue;
+            }
+
+            qx[qt] = m_cx_f[x];
+            qy[qt] = m_cy_f[y];
+            qp[qt++] = xy;
+        }
+    };
+
+    // Lane mask as vector
+    auto lanes = [&]( int a_mask ) CPU_TARGET_AVX2
+    {
+        return _mm256_castsi256_ps( _mm256_cmpgt_epi32( _mm256_and_si256( _mm256_set1_epi32( a_mask ), v_bits ), _mm256_setzero_si256() ));
+    };
+
+    __m256  v_cx = v_zero, v_cy = v_zero, v_zx = v_zero, v_zy = v_zero, v_n = v_park;
+    __m256  v_sx = v_inf, v_sy = v_inf, v_chk = v_one, v_rmx = v_zero, v_der = v_one;
+    __m256  v_zx2, v_zy2, v_r2, v_esc, v_done, v_per, v_sav, v_m;
+    __m256i v_pix = _mm256_setzero_si256(), v_perm;
+
+    while ( 1 )
+    {
+        if ( fill )
+        {
+            // Lanes that are done are refilled with queued pixels (in lane order), or parked if none are left
+            if ( qt - qh < 8 )
+                enqueue();
+
+            cnt = bitCount( fill );
+            if ( cnt > qt - qh )
+            {
+                park = fill;
+                fill = lowBits( fill, qt - qh );
+                park &= ~fill;
+                cnt = qt - qh;
+
+                v_m = lanes( park );
+                v_cx = _mm256_blendv_ps( v_cx, v_zero, v_m );
+                v_cy = _mm256_blendv_ps( v_cy, v_zero, v_m );
+                v_zx = _mm256_blendv_ps( v_zx, v_zero, v_m );
+                v_zy = _mm256_blendv_ps( v_zy, v_zero, v_m );
+                v_n = _mm256_blendv_ps( v_n, v_park, v_m );
+                v_sx = _mm256_blendv_ps( v_sx, v_inf, v_m );
+                v_sy = _mm256_blendv_ps( v_sy, v_inf, v_m );
+            }
+
+            v_m = lanes( fill );
+            v_perm = _mm256_load_si256( (const __m256i*)s_float_expand.idx[fill] );
+            v_cx = _mm256_blendv_ps( v_cx, _mm256_permutevar8x32_ps( _mm256_loadu_ps( qx + qh ), v_perm ), v_m );
+            v_cy = _mm256_blendv_ps( v_cy, _mm256_permutevar8x32_ps( _mm256_loadu_ps( qy + qh ), v_perm ), v_m );
+            v_pix = _mm256_castps_si256( _mm256_blendv_ps( _mm256_castsi256_ps( v_pix ), _mm256_castsi256_ps(
+                    _mm256_permutevar8x32_epi32( _mm256_loadu_si256( (const __m256i*)( qp + qh )), v_perm )), v_m ));
+            v_zx = _mm256_blendv_ps( v_zx, v_cx, v_m );
+            v_zy = _mm256_blendv_ps( v_zy, v_cy, v_m );
+            v_n = _mm256_blendv_ps( v_n, v_zero, v_m );
+            v_sx = _mm256_blendv_ps( v_sx, v_inf, v_m );
+            v_sy = _mm256_blendv_ps( v_sy, v_inf, v_m );
+            v_chk = _mm256_blendv_ps( v_chk, v_one, v_m );
+            v_rmx = _mm256_blendv_ps( v_rmx, v_zero, v_m );
+            v_der = _mm256_blendv_ps( v_der, v_one, v_m );
+
+            qh += cnt;
+            active += cnt;
+            fill = 0;
+
+            if ( !active )
+                break;
+        }
+
+        v_zx2 = _mm256_mul_ps( v_zx, v_zx );
+        v_zy2 = _mm256_mul_ps( v_zy, v_zy );
+        v_r2 = _mm256_add_ps( v_zx2, v_zy2 );
+
+        v_esc = _mm256_cmp_ps( v_r2, v_four, _CMP_NLT_UQ );
+        v_done = _mm256_or_ps( v_esc, _mm256_cmp_ps( v_n, v_mxi, _CMP_GE_OQ ));
+
+        if ( per )
+        {
+            v_per = _mm256_and_ps(
+                _mm256_cmp_ps( _mm256_and_ps( _mm256_sub_ps( v_zx, v_sx ), v_abs ), v_tol, _CMP_LT_OQ ),
+                _mm256_cmp_ps( _mm256_and_ps( _mm256_sub_ps( v_zy, v_sy ), v_abs ), v_tol, _CMP_LT_OQ ));
+            v_done = _mm256_or_ps( v_done, v_per );
+        }
+
+        done = _mm256_movemask_ps( v_done );
+
+        if ( done )
+        {
+            if ( m_cancel )
+                return;
+
+            // Escape is clear of the error bound: |z| - 2 > e at escape, 2 - |z| > e before (e = FLOAT_ERR.sqrt(D))
+            esc = _mm256_movemask_ps( v_esc );
+            v_m = _mm256_mul_ps( v_err, _mm256_sqrt_ps( v_der ));
+            ok = esc & _mm256_movemask_ps( _mm256_and_ps( _mm256_cmp_ps( v_n, v_mxi, _CMP_LT_OQ ), _mm256_and_ps(
+                 _mm256_cmp_ps( _mm256_sub_ps( _mm256_sqrt_ps( v_r2 ), v_two ), v_m, _CMP_GT_OQ ),
+                 _mm256_cmp_ps( _mm256_sub_ps( v_two, _mm256_sqrt_ps( v_rmx )), v_m, _CMP_GT_OQ ))));
+
+            _mm256_store_ps( n, v_n );
+            _mm256_store_si256( (__m256i*)pix, v_pix );
+
+            for ( l = 0; l < 8; l++ )
+            {
+                if ( ok & ( 1 << l ))
+                    m_data->set( (size_t)( pix[l] >> 16 )*m_w + ( pix[l] & 0xFFFF ), (uint32_t)n[l] + 1 );
+                else if ( done & ( 1 << l ))
+                    queueRecheck( redo, redo_cnt, pix[l], &MandelbrotCalc::kernelAVX2, a_stats );
+            }
+
+            active -= bitCount( done );
+            fill = done;
+
+            continue;
+        }
+
+        // Track largest |z|^2 (no lanes have escaped at this point) and error growth: D => 4|z|^2.D + 1
+        v_rmx = _mm256_max_ps( v_rmx, v_r2 );
+        v_der = _mm256_add_ps( _mm256_mul_ps( _mm256_mul_ps( v_r2, v_der ), v_four ), v_one );
+
+        if ( per )
+        {
+            v_sav = _mm256_cmp_ps( v_n, v_chk, _CMP_EQ_OQ );
+            v_sx = _mm256_blendv_ps( v_sx, v_zx, v_sav );
+            v_sy = _mm256_blendv_ps( v_sy, v_zy, v_sav );
+            v_chk = _mm256_blendv_ps( v_chk, _mm256_add_ps( v_chk, v_chk ), v_sav );
+        }
+
+        v_zy = _mm256_add_ps( _mm256_mul_ps( _mm256_add_ps( v_zx, v_zx ), v_zy ), v_cy );
+        v_zx = _mm256_add_ps( _mm256_sub_ps( v_zx2, v_zy2 ), v_cx );
+        v_n = _mm256_add_ps( v_n, v_one );
+    }
+
+    if ( redo_cnt )
+    {
+        kernelAVX2( redo, redo_cnt, a_stats );
+        a_stats.rechecked += redo_cnt;
+    }
+}
+
+/**
+ * @brief AVX-512 float kernel - computes iteration counts for a list of pixels, 16 at a time
+ * @param a_px - Packed pixel coordinates (x | y << 16)
+ * @param a_cnt - Number of pixels in list
+ * @param a_stats - Kernel metrics to update
+ *
+ * See kernelFloatAVX2() for a description of lane refill and float result validation.
+ */
+CPU_TARGET_AVX512 void
+MandelbrotCalc::kernelFloatAVX512( const uint32_t * a_px, uint32_t a_cnt, KernelStats & a_stats )
+{
+    const __m512    v_zero = _mm512_setzero_ps();
+    const __m512    v_one = _mm512_set1_ps( 1.0f );
+    const __m512    v_two = _mm512_set1_ps( 2.0f );
+    const __m512    v_four = _mm512_set1_ps( 4.0f );
+    const __m512    v_inf = _mm512_set1_ps( INFINITY );
+    const __m512    v_park = _mm512_set1_ps( -INFINITY );
+    const __m512    v_err = _mm512_set1_ps( FLOAT_ERR );
+    const __m512    v_mxi = _mm512_set1_ps( m_mxi );
+    const __m512    v_tol = _mm512_set1_ps( std::max( (float)m_per_tol, FLOAT_PER_TOL ));
+    const bool      per = m_per_tol > 0;
+    alignas(64) float qx[FLOAT_QUEUE + 16], qy[FLOAT_QUEUE + 16], n[16];
+    alignas(64) uint32_t qp[FLOAT_QUEUE + 16], pix[16];
+    uint32_t        redo[FLOAT_REDO_MAX], redo_cnt = 0;
+    uint32_t        next = 0, qh = 0, qt = 0, cnt;
+    int             active = 0, l;
+    __mmask16       fill = 0xFFFF, park, done, esc, ok, sav;
+
+    // Moves the pixels left in queue to its front, and queues pixels from the list behind them
+    auto enqueue = [&]() CPU_TARGET_AVX512
+    {
+        for ( cnt = 0; qh < qt; qh++, cnt++ )
+        {
+            qx[cnt] = qx[qh];
+            qy[cnt] = qy[qh];
+            qp[cnt] = qp[qh];
+        }
+
+        qh = 0;
+        qt = cnt;
+
+        while ( qt < FLOAT_QUEUE && next < a_cnt )
+        {
+            uint32_t xy = a_px[next++];
+            uint16_t x = xy & 0xFFFF, y = xy >> 16;
+
+            if ( isInteriorPoint( m_cx[x], m_cy[y] ))
+            {
+                m_data->set( (size_t)y*m_w + x, 0 );
+                a_stats.interior++;
+                continue;
+            }
+
+            qx[qt] = m_cx_f[x];
+            qy[qt] = m_cy_f[y];
+            qp[qt++] = xy;
+        }
+    };
+
+    __m512  v_cx = v_zero, v_cy = v_zero, v_zx = v_zero, v_zy = v_zero, v_n = v_park;
+    __m512  v_sx = v_inf, v_sy = v_inf, v_chk = v_one, v_rmx = v_zero, v_der = v_one;
+    __m512  v_zx2, v_zy2, v_r2, v_e;
+    __m512i v_pix = _mm512_setzero_si512();
+
+    while ( 1 )
+    {
+        if ( fill )
+        {
+            // Lanes that are done are refilled with queued pixels (in lane order), or parked if none are left
+            if ( qt - qh < 16 )
+                enqueue();
+
+            cnt = bitCount( fill );
+            if ( cnt > qt - qh )
+            {
+                park = fill;
+                fill = lowBits( fill, qt - qh );
+                park &= ~fill;
+                cnt = qt - qh;
+
+                v_cx = _mm512_mask_mov_ps( v_cx, park, v_zero );
+                v_cy = _mm512_mask_mov_ps( v_cy, park, v_zero );
+                v_zx = _mm512_mask_mov_ps( v_zx, park, v_zero );
+                v_zy = _mm512_mask_mov_ps( v_zy, park, v_zero );
+                v_n = _mm512_mask_mov_ps( v_n, park, v_park );
+                v_sx = _mm512_mask_mov_ps( v_sx, park, v_inf );
+                v_sy = _mm512_mask_mov_ps( v_sy, park, v_inf );
+            }
+
+            v_cx = _mm512_mask_expandloadu_ps( v_cx, fill, qx + qh );
+            v_cy = _mm512_mask_expandloadu_ps( v_cy, fill, qy + qh );
+            v_pix = _mm512_mask_expandloadu_epi32( v_pix, fill, qp + qh );
+            v_zx = _mm512_mask_mov_ps( v_zx, fill, v_cx );
+            v_zy = _mm512_mask_mov_ps( v_zy, fill, v_cy );
+            v_n = _mm512_mask_mov_ps( v_n, fill, v_zero );
+            v_sx = _mm512_mask_mov_ps( v_sx, fill, v_inf );
+            v_sy = _mm512_mask_mov_ps( v_sy, fill, v_inf );
+            v_chk = _mm512_mask_mov_ps( v_chk, fill, v_one );
+            v_rmx = _mm512_mask_mov_ps( v_rmx, fill, v_zero );
+            v_der = _mm512_mask_mov_ps( v_der, fill, v_one );
+
+            qh += cnt;
+            active += cnt;
+            fill = 0;
+
+            if ( !active )
+                break;
+        }
+
+        v_zx2 = _mm512_mul_ps( v_zx, v_zx );
+        v_zy2 = _mm512_mul_ps( v_zy, v_zy );
+        v_r2 = _mm512_add_ps( v_zx2, v_zy2 );
+
+        esc = _mm512_cmp_ps_mask( v_r2, v_four, _CMP_NLT_UQ );
+        done = esc | _mm512_cmp_ps_mask( v_n, v_mxi, _CMP_GE_OQ );
+
+        if ( per )
+        {
+            done |= _mm512_cmp_ps_mask( _mm512_abs_ps( _mm512_sub_ps( v_zx, v_sx )), v_tol, _CMP_LT_OQ ) &
+                    _mm512_cmp_ps_mask( _mm512_abs_ps( _mm512_sub_ps( v_zy, v_sy )), v_tol, _CMP_LT_OQ );
+        }
+
+        if ( done )
+        {
+            if ( m_cancel )
+                return;
+
+            // Escape is clear of the error bound: |z| - 2 > e at escape, 2 - |z| > e before (e = FLOAT_ERR.sqrt(D))
+            v_e = _mm512_mul_ps( v_err, _mm512_maskz_sqrt_ps( esc, v_der ));
+            ok = esc & _mm512_cmp_ps_mask( v_n, v_mxi, _CMP_LT_OQ ) &
+                 _mm512_cmp_ps_mask( _mm512_sub_ps( _mm512_maskz_sqrt_ps( esc, v_r2 ), v_two ), v_e, _CMP_GT_OQ ) &
+                 _mm512_cmp_ps_mask( _mm512_sub_ps( v_two, _mm512_maskz_sqrt_ps( esc, v_rmx )), v_e, _CMP_GT_OQ );
+
+            _mm512_store_ps( n, v_n );
+            _mm512_store_si512( pix, v_pix );
+
+            for ( l = 0; l < 16; l++ )
+            {
+                if ( ok & ( 1 << l ))
+                    m_data->set( (size_t)( pix[l] >> 16 )*m_w + ( pix[l] & 0xFFFF ), (uint32_t)n[l] + 1 );
+                else if ( done & ( 1 << l ))
+                    queueRecheck( redo, redo_cnt, pix[l], &MandelbrotCalc::kernelAVX512, a_stats );
+            }
+
+            active -= bitCount( done );
+            fill = done;
+
+            continue;
+        }
+
+        // Track largest |z|^2 (no lanes have escaped at this point) and error growth: D => 4|z|^2.D + 1
+        v_rmx = _mm512_mask_mov_ps( v_rmx, _mm512_cmp_ps_mask( v_r2, v_rmx, _CMP_GT_OQ ), v_r2 );
+        v_der = _mm512_add_ps( _mm512_mul_ps( _mm512_mul_ps( v_r2, v_der ), v_four ), v_one );
+
+        if ( per )
+        {
+            sav = _mm512_cmp_ps_mask( v_n, v_chk, _CMP_EQ_OQ );
+            v_sx = _mm512_mask_blend_ps( sav, v_sx, v_zx );
+            v_sy = _mm512_mask_blend_ps( sav, v_sy, v_zy );
+            v_chk = _mm512_mask_blend_ps( sav, v_chk, _mm512_add_ps( v_chk, v_chk ));
+        }
+
+        v_zy = _mm512_add_ps( _mm512_mul_ps( _mm512_add_ps( v_zx, v_zx ), v_zy ), v_cy );
+        v_zx = _mm512_add_ps( _mm512_sub_ps( v_zx2, v_zy2 ), v_cx );
+        v_n = _mm512_add_ps( v_n, v_one );
+    }
+
+    if ( redo_cnt )
+    {
+        kernelAVX512( redo, redo_cnt, a_stats );
+        a_stats.rechecked += redo_cnt;
+    }
+}
+
+#endif // CPU_X86
@@ -0,0 +1,159 @@
+#include <cmath>
+#include <algorithm>
+#include "mandelbrotcalc.h"
+
+using namespace std;
+
+// Max series approximation truncation error as a fraction of (scaled) pixel spacing
+#define SA_TOL 1e-6
+
+/**
+ * @brief Computes series approximation coefficients and the number of iterations they can skip
+ *
+ * The perturbation delta of every pixel is approximated as a cubic polynomial in the
+ * pixel offset dc: dz_n = A_n.dc + B_n.dc^2 + C_n.dc^3, where (from Z_0 = A_0 = B_0 = C_0 = 0)
+ *
+ *   A_n+1 = 2.Z_n.A_n + 1
+ *   B_n+1 = 2.Z_n.B_n + A_n^2
+ *   C_n+1 = 2.Z_n.C_n + 2.A_n.B_n
+ *
+ * Coefficients are advanced along the reference orbit while the cubic term, evaluated
+ * at the largest offset in the image, stays below SA_TOL of the pixel spacing scaled by
+ * |A_n| (i.e. the distance between neighboring pixels after n iterations). To ensure
+ * no pixel escapes within the skipped iterations, the bound |Z_n| + |dz_n| must also stay
+ * below the escape radius. Results are stored in m_sa_iter and m_sa_a/b/c.
+ */
+void
+MandelbrotCalc::calcSeriesApprox()
+{
+    typedef complex<double> cplx;
+
+    const uint32_t  ref_n = m_ref_x.size() - 1;
+    cplx            a( 0 ), b( 0 ), c( 0 ), a1, b1, c1, z;
+    double          r, r2, r3;
+
+    // Largest pixel offset from reference point (coordinate tables are monotonic)
+    r = hypot( max( fabs( m_cx.front() ), fabs( m_cx.back() )), max( fabs( m_cy.front() ), fabs( m_cy.back() )));
+    r2 = r*r;
+    r3 = r2*r;
+
+    m_sa_iter = 0;
+
+    // Note: the reference orbit end may be an escaped value, thus it is never skipped to
+    for ( uint32_t n = 0; n + 1 < ref_n; n++ )
+    {
+        z = cplx( m_ref_x[n], m_ref_y[n] );
+        a1 = 2.0*z*a + 1.0;
+        b1 = 2.0*z*b + a*a;
+        c1 = 2.0*z*c + 2.0*a*b;
+
+        if ( !isfinite( abs( c1 )) || abs( c1 )*r3 > SA_TOL*abs( a1 )*m_delta )
+            break;
+
+        if ( hypot( m_ref_x[n + 1], m_ref_y[n + 1] ) + abs( a1 )*r + abs( b1 )*r2 + abs( c1 )*r3 >= 2 )
+            break;
+
+        a = a1;
+        b = b1;
+        c = c1;
+        m_sa_iter = n + 1;
+    }
+
+    m_sa_a = a;
+    m_sa_b = b;
+    m_sa_c = c;
+}
+
+/**
+ * @brief Perturbation kernel - computes iteration counts for a list of pixels
+ * @param a_px - Packed pixel coordinates (x | y << 16)
+ * @param a_cnt - Number of pixels in list
+ * @param a_stats - Kernel metrics to update
+ *
+ * Each pixel is iterated as a double precision delta (dz) from the reference
+ * orbit (Z) using dz => (2Z + dz)dz + dc, where dc (the pixel offset from the
+ * reference point) is taken from the coordinate tables. The full value z = Z + dz
+ * is used for the escape test.
+ *
+ * When |z| becomes smaller than |dz|, the delta can no longer be represented
+ * accurately relative to the reference (a "glitch"). The pixel is then re-referenced
+ * (rebased) by setting dz = z and restarting at the beginning of the reference
+ * orbit, which is valid since Z_0 = 0. Rebasing also occurs when the end of the
+ * reference orbit is reached (i.e. the reference escaped). This avoids the need
+ * for secondary reference orbits.
+ *
+ * If series approximation is enabled, each pixel starts at iteration m_sa_iter with
+ * dz evaluated from the series coefficients.
+ *
+ * Interior and periodicity checks are not applied as z is not known to full
+ * precision at the pixel spacings this kernel is used for.
+ */
+void
+MandelbrotCalc::kernelPerturb( const uint32_t * a_px, uint32_t a_cnt, KernelStats & a_stats )
+{
+    const uint32_t *    end = a_px + a_cnt;
+    const uint32_t      mxi = m_mxi;
+    const double *      ref_x = &m_ref_x[0];
+    const double *      ref_y = &m_ref_y[0];
+    const uint32_t      ref_n = m_ref_x.size() - 1;
+    uint16_t            x, y;
+    double              dcx, dcy, dzx, dzy, zx, zy, tx, ty, tmp;
+    uint32_t            i, j;
+
+    for ( ; a_px != end; a_px++ )
+    {
+        if ( m_cancel )
+            break;
+
+        x = *a_px & 0xFFFF;
+        y = *a_px >> 16;
+        dcx = m_cx[x];
+        dcy = m_cy[y];
+
+        // Perform calculation: dz => (2Z + dz)dz + dc, starting from z = Z = dz = 0
+
+        dzx = dzy = 0;
+        i = j = 0;
+
+        if ( m_sa_iter )
+        {
+            // Skip initial iterations using series approximation: dz = ((C.dc + B).dc + A).dc
+            complex<double> dc( dcx, dcy ), dz;
+
+            dz = (( m_sa_c*dc + m_sa_b )*dc + m_sa_a )*dc;
+            dzx = dz.real();
+            dzy = dz.imag();
+            i = j = m_sa_iter;
+        }
+
+        while ( ++i <= mxi )
+        {
+            tx = 2*ref_x[j] + dzx;
+            ty = 2*ref_y[j] + dzy;
+            tmp = tx*dzx - ty*dzy + dcx;
+            dzy = tx*dzy + ty*dzx + dcy;
+            dzx = tmp;
+            j++;
+
+            zx = ref_x[j] + dzx;
+            zy = ref_y[j] + dzy;
+            tmp = zx*zx + zy*zy;
+
+            if ( !( tmp < 4 ))
+                break;
+
+            if ( tmp < dzx*dzx + dzy*dzy || j == ref_n )
+            {
+                dzx = zx;
+                dzy = zy;
+                j = 0;
+                a_stats.rebased++;
+            }
+        }
+
+        if ( i > mxi )
+            i = 0;
+
+        m_data->set( (size_t)y*m_w + x, i );
+    }
+}
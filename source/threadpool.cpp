@@ -0,0 +1,114 @@
+#include <algorithm>
+#include "threadpool.h"
+
+using namespace std;
+
+/**
+ * @brief ThreadPool constructor - starts worker threads
+ * @param a_th_cnt - Thread count including calling thread (0 = hardware concurrency)
+ */
+ThreadPool::ThreadPool( unsigned a_th_cnt ):
+    m_func(0),
+    m_cnt(0),
+    m_next(0),
+    m_busy(0),
+    m_job(0),
+    m_stop(false)
+{
+    unsigned th_cnt = a_th_cnt ? a_th_cnt : max( thread::hardware_concurrency(), 1u );
+
+    for ( unsigned t = 1; t < th_cnt; t++ )
+        m_threads.emplace_back( &ThreadPool::worker, this );
+}
+
+/**
+ * @brief ThreadPool destructor - stops worker threads
+ */
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> lock( m_mutex );
+        m_stop = true;
+    }
+
+    m_start_cv.notify_all();
+
+    for ( thread & t : m_threads )
+        t.join();
+}
+
+/**
+ * @brief Runs a job and waits for its completion
+ * @param a_cnt - Item count
+ * @param a_func - Function called with item index
+ */
+void
+ThreadPool::run( uint32_t a_cnt, const function<void( uint32_t )> & a_func )
+{
+    if ( a_cnt == 0 )
+        return;
+
+    // Small jobs are run by calling thread only
+    if ( a_cnt == 1 || m_threads.empty() )
+    {
+        for ( uint32_t i = 0; i < a_cnt; i++ )
+            a_func( i );
+        return;
+    }
+
+    {
+        lock_guard<mutex> lock( m_mutex );
+
+        m_func = &a_func;
+        m_cnt = a_cnt;
+        m_next = 0;
+        m_busy = m_threads.size();
+        m_job++;
+    }
+
+    m_start_cv.notify_all();
+
+    work();
+
+    unique_lock<mutex> lock( m_mutex );
+    m_done_cv.wait( lock, [this]{ return m_busy == 0; });
+    m_func = 0;
+}
+
+/**
+ * @brief Worker thread function - runs jobs until stopped
+ */
+void
+ThreadPool::worker()
+{
+    uint64_t job = 0;
+
+    while ( 1 )
+    {
+        {
+            unique_lock<mutex> lock( m_mutex );
+            m_start_cv.wait( lock, [&]{ return m_stop || m_job != job; });
+
+            if ( m_stop )
+                return;
+
+            job = m_job;
+        }
+
+        work();
+
+        lock_guard<mutex> lock( m_mutex );
+        if ( --m_busy == 0 )
+            m_done_cv.notify_one();
+    }
+}
+
+/**
+ * @brief Runs items of current job until all are claimed
+ */
+void
+ThreadPool::work()
+{
+    for ( uint32_t i; ( i = m_next++ ) < m_cnt; )
+        (*m_func)( i );
+}
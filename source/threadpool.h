@@ -0,0 +1,53 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+/**
+ * @brief The ThreadPool class runs data-parallel jobs on persistent worker threads
+ *
+ * A job is a function called once for each item of a range. Items are claimed in order by
+ * the workers and the calling thread, and run returns when all items are done. Jobs are run
+ * one at a time; run must not be called concurrently or from within a job.
+ */
+class ThreadPool
+{
+public:
+    ThreadPool( unsigned a_th_cnt = 0 );
+    ~ThreadPool();
+
+    void        run( uint32_t a_cnt, const std::function<void( uint32_t )> & a_func );
+
+    /**
+     * @brief Returns the number of threads running jobs (including calling thread)
+     * @return Thread count
+     */
+    unsigned
+    threadCount() const
+    {
+        return m_threads.size() + 1;
+    }
+
+private:
+    void        worker();
+    void        work();
+
+    std::vector<std::thread>    m_threads;
+    std::mutex                  m_mutex;
+    std::condition_variable     m_start_cv;     // Signals new job (or stop) to workers
+    std::condition_variable     m_done_cv;      // Signals job completion to calling thread
+    const std::function<void( uint32_t )> * m_func; // Function of current job
+    uint32_t                    m_cnt;          // Item count of current job
+    std::atomic<uint32_t>       m_next;         // Next unclaimed item of current job
+    uint32_t                    m_busy;         // Workers running current job
+    uint64_t                    m_job;          // Job sequence number
+    bool                        m_stop;         // Workers must exit
+};
+
+#endif // THREADPOOL_H
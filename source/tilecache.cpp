@@ -0,0 +1,109 @@
+#include <functional>
+#include "tilecache.h"
+
+using namespace std;
+
+/**
+ * @brief TileCache constructor - creates an empty cache with no budget (disabled)
+ */
+TileCache::TileCache():
+    m_budget(0)
+{}
+
+/**
+ * @brief Sets the memory budget of the cache, evicting least recently used tiles if needed
+ * @param a_bytes - Max memory used by tiles (0 disables cache)
+ */
+void
+TileCache::setBudget( size_t a_bytes )
+{
+    m_budget = a_bytes/( sizeof( Entry ) + SIZE*SIZE*sizeof( uint32_t ));
+    evict();
+}
+
+/**
+ * @brief Finds a tile and marks it as most recently used
+ * @param a_key - Tile key
+ * @return Tile, or null if not in cache
+ */
+TileCache::Entry *
+TileCache::find( const Key & a_key )
+{
+    unordered_map<Key, list<Entry>::iterator, KeyHash>::iterator i = m_index.find( a_key );
+
+    if ( i == m_index.end() )
+        return 0;
+
+    m_entries.splice( m_entries.begin(), m_entries, i->second );
+
+    return &*i->second;
+}
+
+/**
+ * @brief Inserts a tile (or finds existing tile) and marks it as most recently used
+ * @param a_key - Tile key
+ * @return Tile (data sized, contents must be set by caller)
+ *
+ * If the cache is full, the least recently used tile is evicted (reusing its memory).
+ */
+TileCache::Entry &
+TileCache::insert( const Key & a_key )
+{
+    Entry * e = find( a_key );
+
+    if ( e )
+        return *e;
+
+    if ( m_entries.size() && m_entries.size() >= m_budget )
+    {
+        m_index.erase( m_entries.back().key );
+        m_entries.splice( m_entries.begin(), m_entries, prev( m_entries.end() ));
+    }
+    else
+    {
+        m_entries.emplace_front();
+        m_entries.front().data.resize( SIZE*SIZE );
+    }
+
+    m_entries.front().key = a_key;
+    m_index[a_key] = m_entries.begin();
+
+    return m_entries.front();
+}
+
+/**
+ * @brief Evicts least recently used tiles until cache is within budget
+ */
+void
+TileCache::evict()
+{
+    while ( m_entries.size() > m_budget )
+    {
+        m_index.erase( m_entries.back().key );
+        m_entries.pop_back();
+    }
+}
+
+/**
+ * @brief Computes hash of a key
+ * @param a_key - Tile key
+ * @return Hash value
+ */
+size_t
+TileCache::KeyHash::operator()( const Key & a_key ) const
+{
+    size_t h = hash<int64_t>()( a_key.spacing );
+
+    // Boost style hash combine
+    auto combine = [&h]( uint64_t a_value )
+    {
+        h ^= hash<uint64_t>()( a_value ) + 0x9e3779b97f4a7c15ULL + ( h << 6 ) + ( h >> 2 );
+    };
+
+    combine( a_key.x );
+    combine( a_key.y );
+    combine(((uint64_t)a_key.phase_x << 16 ) | a_key.phase_y );
+    combine(((uint64_t)a_key.iter_mx << 8 ) | a_key.variant );
+
+    return h;
+}
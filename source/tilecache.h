@@ -0,0 +1,97 @@
+#ifndef TILECACHE_H
+#define TILECACHE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <list>
+#include <unordered_map>
+
+/**
+ * @brief The TileCache class implements a memory bounded LRU cache of calculated image tiles
+ *
+ * Tiles are square blocks of pixels on a global lattice, i.e. the complex plane divided
+ * into pixels of a given spacing and sub-pixel offset (phase), thus a tile is found by
+ * any image that shares its lattice regardless of the image bounds. As images rarely
+ * cover whole tiles, each tile holds the part of the block (valid region) calculated by
+ * the image that stored it.
+ *
+ * Keys are quantized, thus the exact spacing and coordinates of each tile are kept so
+ * that the user of the cache can verify that the pixels coincide. The cache is not
+ * thread safe.
+ */
+class TileCache
+{
+public:
+    static const uint16_t SIZE = 64;    // Tile size (pixels)
+
+    /**
+     * @brief The Key struct identifies a tile on a lattice
+     */
+    struct Key
+    {
+        int64_t     spacing;    // Quantized pixel spacing
+        int64_t     x;          // Tile column on lattice
+        int64_t     y;          // Tile line on lattice
+        uint16_t    phase_x;    // Quantized sub-pixel offset of lattice (real axis)
+        uint16_t    phase_y;    // Quantized sub-pixel offset of lattice (imaginary axis)
+        uint32_t    iter_mx;    // Max iterations
+        uint8_t     variant;    // Kernel type and options affecting results
+
+        bool
+        operator==( const Key & a_other ) const
+        {
+            return spacing == a_other.spacing && x == a_other.x && y == a_other.y && phase_x == a_other.phase_x &&
+                   phase_y == a_other.phase_y && iter_mx == a_other.iter_mx && variant == a_other.variant;
+        }
+    };
+
+    /**
+     * @brief The Entry struct holds a cached tile
+     */
+    struct Entry
+    {
+        Key                     key;
+        double                  delta;      // Pixel spacing
+        double                  cx;         // Real coordinate of tile column 0
+        double                  cy;         // Imaginary coordinate of tile line 0
+        uint16_t                x;          // Valid region left column
+        uint16_t                y;          // Valid region bottom line
+        uint16_t                w;          // Valid region width
+        uint16_t                h;          // Valid region height
+        std::vector<uint32_t>   data;       // Iteration counts (SIZE x SIZE, valid region only)
+    };
+
+    /**
+     * @brief Hash function for keys
+     */
+    struct KeyHash
+    {
+        size_t operator()( const Key & a_key ) const;
+    };
+
+    TileCache();
+
+    void        setBudget( size_t a_bytes );
+    Entry *     find( const Key & a_key );
+    Entry &     insert( const Key & a_key );
+
+    /**
+     * @brief Returns the number of tiles in cache
+     * @return Tile count
+     */
+    size_t
+    size() const
+    {
+        return m_entries.size();
+    }
+
+private:
+    void        evict();
+
+    std::list<Entry>            m_entries;  // Tiles, most to least recently used
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> m_index; // Tile lookup
+    size_t                      m_budget;   // Max number of tiles
+};
+
+#endif // TILECACHE_H
@@ -0,0 +1,629 @@
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+#include "tilestore.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+using namespace std;
+
+// Pack file header marker and format version
+#define PACK_MAGIC "MBTPACK"
+#define PACK_VERSION 1
+
+// Record and index trailer markers
+#define RECORD_MAGIC 0x3154424D
+#define INDEX_MAGIC 0x5844494D
+
+// Pack size limits (max pack size is 1/8 of cap, thus eviction releases ~1/8 of store)
+#define PACK_SIZE_MIN 0x40000
+#define PACK_SIZE_MAX 0x4000000
+
+/**
+ * @brief The PackHeader struct is the header of a pack file
+ */
+struct PackHeader
+{
+    char        magic[8];       // Pack marker
+    uint32_t    version;        // Format version
+    uint32_t    record_size;    // Record header size (detects layout of other builds)
+};
+
+/**
+ * @brief The PackTrailer struct follows the index of a sealed pack (end of file)
+ */
+struct PackTrailer
+{
+    uint64_t    index;          // Offset of index
+    uint32_t    count;          // Number of index entries
+    uint32_t    magic;          // Index marker
+};
+
+/**
+ * @brief Returns the size of a record (header and data, padded to a multiple of 8)
+ * @param a_w - Valid region width
+ * @param a_h - Valid region height
+ * @return Record size in bytes
+ */
+static uint32_t
+recordSize( uint16_t a_w, uint16_t a_h )
+{
+    return ( sizeof( TileStore::Record ) + (uint32_t)a_w*a_h*sizeof( uint32_t ) + 7 ) & ~7U;
+}
+
+/**
+ * @brief TileStore constructor - creates a closed store
+ */
+TileStore::TileStore():
+    m_cur( 0 ), m_total( 0 ), m_cap( 0 ), m_pack_mx( PACK_SIZE_MIN )
+{
+    setCap( (uint64_t)1 << 30 );
+}
+
+/**
+ * @brief TileStore destructor - closes store (sealing current pack)
+ */
+TileStore::~TileStore()
+{
+    close();
+}
+
+/**
+ * @brief Opens a store directory (created if needed) and loads the pack indexes
+ * @param a_dir - Store directory
+ * @param a_cap - Max total size of the packs in bytes (see setCap)
+ * @return True if store opened, false on error
+ *
+ * Any open store is closed first. Packs with an invalid header (e.g. incomplete, or written
+ * by a build with a different layout) are deleted. Packs are only evicted to the given cap,
+ * thus the cap must be known before opening.
+ */
+bool
+TileStore::open( const string & a_dir, uint64_t a_cap )
+{
+    error_code          ec;
+    vector<IndexEntry>  entries;
+
+    close();
+
+    filesystem::create_directories( a_dir, ec );
+    if ( !filesystem::is_directory( a_dir, ec ))
+        return false;
+
+    for ( const filesystem::directory_entry & f : filesystem::directory_iterator( a_dir, ec ))
+    {
+        string name = f.path().filename().string();
+
+        if ( name.size() != 17 || name.compare( 0, 5, "pack-" ) || name.compare( 13, 4, ".mbt" ) ||
+             !all_of( name.begin() + 5, name.begin() + 13, []( char c ){ return c >= '0' && c <= '9'; }))
+        {
+            continue;
+        }
+
+        Pack p = { f.path().string(), f.file_size( ec ), 0, 0, 0, 0, 0 };
+        const PackHeader * hdr;
+
+        if ( ec || p.len < sizeof( PackHeader ) || !mapPack( p ) )
+        {
+            filesystem::remove( p.path, ec );
+            continue;
+        }
+
+        hdr = reinterpret_cast<const PackHeader*>( p.map );
+        if ( memcmp( hdr->magic, PACK_MAGIC, sizeof( hdr->magic )) || hdr->version != PACK_VERSION ||
+             hdr->record_size != sizeof( Record ))
+        {
+            unmapPack( p );
+            filesystem::remove( p.path, ec );
+            continue;
+        }
+
+        m_packs[stoul( name.substr( 5, 8 ))] = p;
+        m_total += p.len;
+    }
+
+    // Later records supersede earlier ones (packs are in order of number)
+    for ( map<uint32_t, Pack>::iterator p = m_packs.begin(); p != m_packs.end(); p++ )
+    {
+        readEntries( p->second, entries );
+
+        for ( const IndexEntry & e : entries )
+        {
+            m_index[e.key] = { p->first, 0, e.offset };
+        }
+    }
+
+    m_dir = a_dir;
+    setCap( a_cap );
+
+    return true;
+}
+
+/**
+ * @brief Closes the store, sealing the current pack
+ */
+void
+TileStore::close()
+{
+    if ( m_cur )
+        seal();
+
+    for ( map<uint32_t, Pack>::iterator p = m_packs.begin(); p != m_packs.end(); p++ )
+    {
+        unmapPack( p->second );
+    }
+
+    m_packs.clear();
+    m_index.clear();
+    m_dir.clear();
+    m_total = 0;
+}
+
+/**
+ * @brief Sets the max total size of the packs, evicting packs if needed
+ * @param a_bytes - Max size in bytes (at least one pack is kept)
+ */
+void
+TileStore::setCap( uint64_t a_bytes )
+{
+    m_cap = a_bytes;
+    m_pack_mx = min<uint64_t>( max<uint64_t>( a_bytes/8, PACK_SIZE_MIN ), PACK_SIZE_MAX );
+
+    evict();
+}
+
+/**
+ * @brief Finds a tile
+ * @param a_key - Tile key
+ * @return Tile record (in mapped pack), or null if not stored
+ *
+ * The record is valid until the next call to a non-const method.
+ */
+const TileStore::Record *
+TileStore::find( const TileCache::Key & a_key )
+{
+    unordered_map<TileCache::Key, Loc, TileCache::KeyHash>::iterator i = m_index.find( a_key );
+
+    if ( i == m_index.end() )
+        return 0;
+
+    Pack & p = m_packs[i->second.pack];
+
+    // Records appended since the current pack was mapped require a new mapping
+    if ( i->second.offset + sizeof( Record ) > p.map_len && p.file )
+    {
+        fflush( p.file );
+        mapPack( p );
+    }
+
+    const Record * r = record( p, i->second.offset );
+
+    if ( r )
+        i->second.used = 1;
+
+    return r;
+}
+
+/**
+ * @brief Appends a tile to the current pack
+ * @param a_rec - Tile header (magic and size are set by store)
+ * @param a_data - Iteration counts of the valid region
+ * @param a_stride - Distance between lines of a_data (pixels)
+ * @return True if stored, false on error
+ *
+ * The record supersedes any previous record of the tile. The current pack is sealed and a
+ * new pack started when the record would exceed the max pack size.
+ */
+bool
+TileStore::append( const Record & a_rec, const uint32_t * a_data, size_t a_stride )
+{
+    const uint32_t  size = recordSize( a_rec.w, a_rec.h );
+    const uint64_t  zero = 0;
+    Record          hdr;
+
+    if ( m_dir.empty() )
+        return false;
+
+    if ( m_cur && m_packs[m_cur].len + size > m_pack_mx && m_packs[m_cur].len > sizeof( PackHeader ))
+        seal();
+
+    if ( !m_cur && !newPack() )
+        return false;
+
+    Pack & p = m_packs[m_cur];
+
+    memset( &hdr, 0, sizeof( hdr ));
+    hdr.magic = RECORD_MAGIC;
+    hdr.size = size;
+    hdr.key = a_rec.key;
+    hdr.delta = a_rec.delta;
+    hdr.cx = a_rec.cx;
+    hdr.cy = a_rec.cy;
+    hdr.x = a_rec.x;
+    hdr.y = a_rec.y;
+    hdr.w = a_rec.w;
+    hdr.h = a_rec.h;
+
+    fwrite( &hdr, sizeof( hdr ), 1, p.file );
+    for ( uint16_t y = 0; y < a_rec.h; y++ )
+    {
+        fwrite( a_data + y*a_stride, sizeof( uint32_t ), a_rec.w, p.file );
+    }
+    fwrite( &zero, 1, size - sizeof( hdr ) - (uint32_t)a_rec.w*a_rec.h*sizeof( uint32_t ), p.file );
+
+    if ( ferror( p.file ))
+    {
+        // Pack is left unsealed; its records are scanned up to the incomplete one when reopened
+        fclose( p.file );
+        p.file = 0;
+        m_cur = 0;
+
+        return false;
+    }
+
+    m_index[hdr.key] = { m_cur, 0, p.len };
+    p.len += size;
+    p.end = p.len;
+    m_total += size;
+
+    return true;
+}
+
+/**
+ * @brief Writes appended tiles to the current pack and evicts packs over the cap
+ * @return True if written, false on error
+ */
+bool
+TileStore::flush()
+{
+    bool ok = true;
+
+    if ( m_cur )
+    {
+        Pack & p = m_packs[m_cur];
+
+        ok = fflush( p.file ) == 0;
+        if ( ok && p.map_len < p.len )
+            mapPack( p );
+    }
+
+    evict();
+
+    return ok;
+}
+
+/**
+ * @brief Rewrites the current records of all packs into new packs (offline maintenance)
+ * @return True if compacted, false on error (store remains valid)
+ *
+ * Superseded records and records of evicted tiles are discarded, and unsealed packs are
+ * replaced by sealed ones. Records keep their order (i.e. age) and second chance state.
+ * The old packs are deleted once their records are copied.
+ */
+bool
+TileStore::compact()
+{
+    vector<uint32_t>    old;
+    vector<IndexEntry>  entries;
+
+    if ( m_dir.empty() )
+        return false;
+
+    if ( m_cur && !seal() )
+        return false;
+
+    for ( map<uint32_t, Pack>::iterator p = m_packs.begin(); p != m_packs.end(); p++ )
+    {
+        old.push_back( p->first );
+    }
+
+    for ( uint32_t id : old )
+    {
+        Pack & p = m_packs[id];
+
+        readEntries( p, entries );
+
+        for ( const IndexEntry & e : entries )
+        {
+            unordered_map<TileCache::Key, Loc, TileCache::KeyHash>::iterator i = m_index.find( e.key );
+
+            if ( i == m_index.end() || i->second.pack != id || i->second.offset != e.offset )
+                continue;
+
+            const Record *  r = record( p, e.offset );
+            uint32_t        used = i->second.used;
+
+            if ( !r )
+            {
+                m_index.erase( i );
+                continue;
+            }
+
+            if ( !append( *r, r->data(), r->w ))
+                return false;
+
+            m_index[e.key].used = used;
+        }
+
+        unmapPack( p );
+        if ( p.file )
+            fclose( p.file );
+
+        error_code ec;
+        filesystem::remove( p.path, ec );
+        m_total -= p.len;
+        m_packs.erase( id );
+    }
+
+    if ( m_cur && !seal() )
+        return false;
+
+    evict();
+
+    return true;
+}
+
+/**
+ * @brief Maps (or remaps) a pack file for reading
+ * @param a_pack - Pack (len must be set)
+ * @return True if mapped, false on error
+ */
+bool
+TileStore::mapPack( Pack & a_pack )
+{
+    unmapPack( a_pack );
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA( a_pack.path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                               0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0 );
+    if ( file == INVALID_HANDLE_VALUE )
+        return false;
+
+    HANDLE mapping = CreateFileMappingA( file, 0, PAGE_READONLY, (DWORD)( a_pack.len >> 32 ), (DWORD)a_pack.len, 0 );
+    CloseHandle( file );
+    if ( !mapping )
+        return false;
+
+    void * addr = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, (SIZE_T)a_pack.len );
+    if ( !addr )
+    {
+        CloseHandle( mapping );
+        return false;
+    }
+
+    a_pack.handle = mapping;
+#else
+    int fd = ::open( a_pack.path.c_str(), O_RDONLY );
+    if ( fd < 0 )
+        return false;
+
+    void * addr = mmap( 0, a_pack.len, PROT_READ, MAP_SHARED, fd, 0 );
+    ::close( fd );
+    if ( addr == MAP_FAILED )
+        return false;
+#endif
+
+    a_pack.map = static_cast<const uint8_t*>( addr );
+    a_pack.map_len = a_pack.len;
+
+    return true;
+}
+
+/**
+ * @brief Unmaps a pack file
+ * @param a_pack - Pack
+ */
+void
+TileStore::unmapPack( Pack & a_pack )
+{
+    if ( !a_pack.map )
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile( a_pack.map );
+    CloseHandle( a_pack.handle );
+    a_pack.handle = 0;
+#else
+    munmap( const_cast<uint8_t*>( a_pack.map ), a_pack.map_len );
+#endif
+
+    a_pack.map = 0;
+    a_pack.map_len = 0;
+}
+
+/**
+ * @brief Validates and returns a record of a mapped pack
+ * @param a_pack - Pack
+ * @param a_offset - Record offset
+ * @return Record, or null if offset does not hold a complete record
+ */
+const TileStore::Record *
+TileStore::record( const Pack & a_pack, uint64_t a_offset ) const
+{
+    const uint64_t end = min( a_pack.end, a_pack.map_len );
+
+    if ( a_offset + sizeof( Record ) > end || a_offset % 8 )
+        return 0;
+
+    const Record * r = reinterpret_cast<const Record*>( a_pack.map + a_offset );
+
+    if ( r->magic != RECORD_MAGIC || a_offset + r->size > end || r->x + r->w > TileCache::SIZE ||
+         r->y + r->h > TileCache::SIZE || r->size != recordSize( r->w, r->h ))
+    {
+        return 0;
+    }
+
+    return r;
+}
+
+/**
+ * @brief Reads the index entries of a pack
+ * @param a_pack - Pack (mapped, not current)
+ * @param a_entries - Receives entries in record order
+ *
+ * The index of a sealed pack is read from its end. The records of an unsealed pack are
+ * scanned up to the first incomplete record (which sets the end of the pack).
+ */
+void
+TileStore::readEntries( const Pack & a_pack, vector<IndexEntry> & a_entries ) const
+{
+    const PackTrailer * t = 0;
+    const Record *      r;
+    uint64_t            off;
+
+    a_entries.clear();
+
+    if ( a_pack.map_len >= sizeof( PackHeader ) + sizeof( PackTrailer ))
+        t = reinterpret_cast<const PackTrailer*>( a_pack.map + a_pack.map_len - sizeof( PackTrailer ));
+
+    if ( t && t->magic == INDEX_MAGIC && t->index >= sizeof( PackHeader ) && t->index % 8 == 0 &&
+         t->index + (uint64_t)t->count*sizeof( IndexEntry ) + sizeof( PackTrailer ) == a_pack.map_len )
+    {
+        const IndexEntry * e = reinterpret_cast<const IndexEntry*>( a_pack.map + t->index );
+
+        a_entries.assign( e, e + t->count );
+        const_cast<Pack&>( a_pack ).end = t->index;
+    }
+    else
+    {
+        const_cast<Pack&>( a_pack ).end = a_pack.map_len;
+
+        for ( off = sizeof( PackHeader ); ( r = record( a_pack, off )); off += r->size )
+        {
+            a_entries.push_back({ r->key, off });
+        }
+
+        const_cast<Pack&>( a_pack ).end = off;
+    }
+}
+
+/**
+ * @brief Creates a new (current) pack numbered after the last pack
+ * @return True if created, false on error
+ */
+bool
+TileStore::newPack()
+{
+    const uint32_t  id = m_packs.empty() ? 1 : m_packs.rbegin()->first + 1;
+    PackHeader      hdr;
+    char            name[32];
+
+    snprintf( name, sizeof( name ), "pack-%08u.mbt", id );
+
+    string  path = ( filesystem::path( m_dir ) / name ).string();
+    FILE *  file = fopen( path.c_str(), "wbx" );
+
+    if ( !file )
+        return false;
+
+    memset( &hdr, 0, sizeof( hdr ));
+    memcpy( hdr.magic, PACK_MAGIC, sizeof( hdr.magic ));
+    hdr.version = PACK_VERSION;
+    hdr.record_size = sizeof( Record );
+
+    if ( fwrite( &hdr, sizeof( hdr ), 1, file ) != 1 )
+    {
+        fclose( file );
+        return false;
+    }
+
+    m_packs[id] = { path, sizeof( hdr ), sizeof( hdr ), file, 0, 0, 0 };
+    m_cur = id;
+    m_total += sizeof( hdr );
+
+    return true;
+}
+
+/**
+ * @brief Seals the current pack by appending the index of its current records
+ * @return True if sealed, false on error (pack is left unsealed)
+ */
+bool
+TileStore::seal()
+{
+    Pack &              p = m_packs[m_cur];
+    vector<IndexEntry>  entries;
+    PackTrailer         t;
+
+    for ( unordered_map<TileCache::Key, Loc, TileCache::KeyHash>::iterator i = m_index.begin(); i != m_index.end(); i++ )
+    {
+        if ( i->second.pack == m_cur )
+        {
+            entries.push_back({ i->first, i->second.offset });
+        }
+    }
+
+    sort( entries.begin(), entries.end(), []( const IndexEntry & a, const IndexEntry & b ){ return a.offset < b.offset; });
+
+    memset( &t, 0, sizeof( t ));
+    t.index = p.len;
+    t.count = entries.size();
+    t.magic = INDEX_MAGIC;
+
+    fwrite( entries.data(), sizeof( IndexEntry ), entries.size(), p.file );
+    fwrite( &t, sizeof( t ), 1, p.file );
+
+    bool ok = !ferror( p.file );
+
+    ok = fclose( p.file ) == 0 && ok;
+    p.file = 0;
+    m_cur = 0;
+
+    if ( ok )
+    {
+        p.len += entries.size()*sizeof( IndexEntry ) + sizeof( t );
+        m_total += entries.size()*sizeof( IndexEntry ) + sizeof( t );
+    }
+
+    mapPack( p );
+
+    return ok;
+}
+
+/**
+ * @brief Evicts oldest packs until the total size is within the cap
+ *
+ * Records of an evicted pack that were read since written are copied to the current pack.
+ */
+void
+TileStore::evict()
+{
+    vector<IndexEntry>  entries;
+    error_code          ec;
+
+    while ( m_total > m_cap && m_packs.size() > 1 && m_packs.begin()->first != m_cur )
+    {
+        const uint32_t  id = m_packs.begin()->first;
+        Pack &          p = m_packs.begin()->second;
+
+        readEntries( p, entries );
+
+        for ( const IndexEntry & e : entries )
+        {
+            unordered_map<TileCache::Key, Loc, TileCache::KeyHash>::iterator i = m_index.find( e.key );
+
+            if ( i == m_index.end() || i->second.pack != id || i->second.offset != e.offset )
+                continue;
+
+            const Record * r = i->second.used ? record( p, e.offset ) : 0;
+
+            if ( !r || !append( *r, r->data(), r->w ))
+                m_index.erase( e.key );
+        }
+
+        unmapPack( p );
+        if ( p.file )
+            fclose( p.file );
+
+        filesystem::remove( p.path, ec );
+        m_total -= p.len;
+        m_packs.erase( id );
+    }
+}
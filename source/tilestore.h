@@ -0,0 +1,157 @@
+#ifndef TILESTORE_H
+#define TILESTORE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include "tilecache.h"
+
+/**
+ * @brief The TileStore class implements a persistent on-disk store of calculated image tiles
+ *
+ * Tiles (see TileCache) are appended as records to pack files in the store directory. Packs
+ * are memory-mapped for reading, thus a tile found in the store is used in place (zero-copy)
+ * and only the pages of the tiles that are read are loaded from disk. A record holds only
+ * the valid region of its tile. Storing a tile again (e.g. with a larger valid region)
+ * appends a new record that supersedes the previous one.
+ *
+ * Each session appends to a new pack, which is sealed when it reaches its max size or
+ * when the store is closed. Sealing appends an index of the pack records (key and offset)
+ * so that opening the store reads the indexes only. The records of unsealed packs (e.g.
+ * after a crash) are scanned instead, up to the first incomplete record.
+ *
+ * When the total size of the packs exceeds the cap, the oldest pack is evicted as a whole.
+ * Records of the evicted pack that were read since they were written are first copied to
+ * the current pack (second chance), thus frequently used tiles are kept. Superseded and
+ * evicted records are only reclaimed from disk by compaction, which rewrites the current
+ * records into new packs (see compact).
+ *
+ * Packs are stored in native byte order and layout. The store is not thread safe, and a
+ * store directory should be used by one process at a time.
+ */
+class TileStore
+{
+public:
+    /**
+     * @brief The Record struct is the header of a stored tile (followed by its data)
+     */
+    struct Record
+    {
+        uint32_t            magic;      // Record marker
+        uint32_t            size;       // Record size in bytes including header (multiple of 8)
+        TileCache::Key      key;
+        double              delta;      // Pixel spacing
+        double              cx;         // Real coordinate of tile column 0
+        double              cy;         // Imaginary coordinate of tile line 0
+        uint16_t            x;          // Valid region left column
+        uint16_t            y;          // Valid region bottom line
+        uint16_t            w;          // Valid region width
+        uint16_t            h;          // Valid region height
+
+        /**
+         * @brief Returns the iteration counts of the valid region (w x h, row-major)
+         * @return Pointer to data following header
+         */
+        const uint32_t *
+        data() const
+        {
+            return reinterpret_cast<const uint32_t*>( this + 1 );
+        }
+    };
+
+    TileStore();
+    ~TileStore();
+
+    bool                open( const std::string & a_dir, uint64_t a_cap );
+    void                close();
+    void                setCap( uint64_t a_bytes );
+    const Record *      find( const TileCache::Key & a_key );
+    bool                append( const Record & a_rec, const uint32_t * a_data, size_t a_stride );
+    bool                flush();
+    bool                compact();
+
+    /**
+     * @brief Returns the store directory
+     * @return Directory path (empty if store is not open)
+     */
+    const std::string &
+    dir() const
+    {
+        return m_dir;
+    }
+
+    /**
+     * @brief Returns the total size of the pack files
+     * @return Size in bytes
+     */
+    uint64_t
+    size() const
+    {
+        return m_total;
+    }
+
+    /**
+     * @brief Returns the number of stored tiles (current records)
+     * @return Tile count
+     */
+    size_t
+    count() const
+    {
+        return m_index.size();
+    }
+
+private:
+    /**
+     * @brief The Pack struct holds the state of an open pack file
+     */
+    struct Pack
+    {
+        std::string         path;       // File path
+        uint64_t            len;        // File length
+        uint64_t            end;        // End of records (start of index if sealed)
+        FILE *              file;       // Append stream (current pack only, null if sealed)
+        const uint8_t *     map;        // Mapped file contents (null if not mapped)
+        uint64_t            map_len;    // Mapped length
+        void *              handle;     // File mapping handle (Windows only)
+    };
+
+    /**
+     * @brief The IndexEntry struct locates a record in a pack (sealed pack index)
+     */
+    struct IndexEntry
+    {
+        TileCache::Key      key;
+        uint64_t            offset;     // Record offset in pack
+    };
+
+    /**
+     * @brief The Loc struct locates the current record of a tile
+     */
+    struct Loc
+    {
+        uint32_t            pack;       // Pack number
+        uint32_t            used;       // Record read since written (second chance on eviction)
+        uint64_t            offset;     // Record offset in pack
+    };
+
+    bool                mapPack( Pack & a_pack );
+    void                unmapPack( Pack & a_pack );
+    const Record *      record( const Pack & a_pack, uint64_t a_offset ) const;
+    void                readEntries( const Pack & a_pack, std::vector<IndexEntry> & a_entries ) const;
+    bool                newPack();
+    bool                seal();
+    void                evict();
+
+    std::string                 m_dir;      // Store directory (empty if not open)
+    std::map<uint32_t, Pack>    m_packs;    // Packs by number, oldest first
+    uint32_t                    m_cur;      // Number of current (append) pack, 0 if none
+    uint64_t                    m_total;    // Total size of packs
+    uint64_t                    m_cap;      // Max total size of packs
+    uint64_t                    m_pack_mx;  // Max size of a pack
+    std::unordered_map<TileCache::Key, Loc, TileCache::KeyHash> m_index; // Current record of each tile
+};
+
+#endif // TILESTORE_H